@@ -0,0 +1,275 @@
+#include <prs/calendar_queue.h>
+#include <prs/radix_heap.h>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <stdio.h>
+
+// Microbenchmarks for calendar_queue. Each benchmark keeps a small population
+// of pending events and repeatedly pops the earliest one and schedules a
+// replacement a random delay in the future, the same access pattern the
+// simulator produces.
+
+struct bench_event {
+	uint64_t time;
+	int id;
+};
+
+struct bench_priority {
+	uint64_t operator()(const bench_event &e) {
+		return e.time;
+	}
+};
+
+using clock_type = std::chrono::steady_clock;
+
+template <typename Q>
+double churn(Q &queue, int population, int iterations, uint64_t max_delay, uint64_t seed) {
+	std::mt19937_64 rng(seed);
+	std::uniform_int_distribution<uint64_t> delay(1u, max_delay);
+
+	for (int i = 0; i < population; i++) {
+		queue.push(bench_event{delay(rng), i});
+	}
+
+	auto start = clock_type::now();
+	for (int i = 0; i < iterations; i++) {
+		bench_event e = queue.pop();
+		queue.push(bench_event{e.time + delay(rng), e.id});
+	}
+	auto stop = clock_type::now();
+	return std::chrono::duration<double, std::nano>(stop - start).count() / (double)iterations;
+}
+
+// Pop cost as a function of the number of day buckets for a sparse queue.
+// day_scan walks every empty bucket between events while day_bitmap skips
+// them with count trailing zeros, so its cost should stay flat.
+void bench_next() {
+	const int year = 20;
+	const int population = 64;
+	const int iterations = 200000;
+
+	printf("next(): %d events, delays up to one year (2^%d)\n", population, year);
+	printf("%10s %16s %16s\n", "days", "day_scan ns/op", "day_bitmap ns/op");
+	for (int mindiff = 8; mindiff <= 18; mindiff += 2) {
+		calendar_queue<bench_event, bench_priority, day_scan> scan(year, mindiff);
+		calendar_queue<bench_event, bench_priority, day_bitmap> bitmap(year, mindiff);
+		double t0 = churn(scan, population, iterations, 1ul<<year, 1);
+		double t1 = churn(bitmap, population, iterations, 1ul<<year, 1);
+		printf("%10lu %16.1f %16.1f\n", (unsigned long)scan.days(), t0, t1);
+	}
+}
+
+// Churn and copy cost of the two event storage modes with a large population.
+// arena_events keeps every event in one contiguous vector with 32 bit links,
+// so the in-bucket search in add() touches fewer cache lines and a copy of
+// the queue does not have to rewrite any links.
+void bench_storage() {
+	const int iterations = 1000000;
+
+	printf("storage: delays up to 2^14\n");
+	printf("%10s %16s %16s %16s %16s\n", "events", "deque ns/op", "arena ns/op", "deque copy us", "arena copy us");
+	for (int population = 1000; population <= 1000000; population *= 10) {
+		calendar_queue<bench_event, bench_priority, day_bitmap, deque_events<bench_event> > deque;
+		calendar_queue<bench_event, bench_priority, day_bitmap, arena_events<bench_event> > arena;
+		double t0 = churn(deque, population, iterations, 1ul<<14, 1);
+		double t1 = churn(arena, population, iterations, 1ul<<14, 1);
+
+		auto start = clock_type::now();
+		auto deque_copy = deque;
+		auto stop = clock_type::now();
+		double c0 = std::chrono::duration<double, std::micro>(stop - start).count();
+
+		start = clock_type::now();
+		auto arena_copy = arena;
+		stop = clock_type::now();
+		double c1 = std::chrono::duration<double, std::micro>(stop - start).count();
+
+		printf("%10d %16.1f %16.1f %16.1f %16.1f\n", population, t0, t1, c0, c1);
+	}
+}
+
+// Cancel and reschedule with a high cancel ratio. Each step either cancels a
+// random pending event and schedules its replacement, or pops the earliest
+// event and schedules its successor. Eager cancellation unlinks the event
+// immediately with pop(e), lazy cancellation leaves a tombstone with
+// cancel(e).
+template <typename Q>
+double cancel_churn(Q &queue, bool lazy, int population, int iterations, double ratio, uint64_t max_delay, uint64_t seed) {
+	std::mt19937_64 rng(seed);
+	std::uniform_int_distribution<uint64_t> delay(1u, max_delay);
+	std::uniform_real_distribution<double> coin(0.0, 1.0);
+	std::uniform_int_distribution<int> pick(0, population-1);
+
+	std::vector<typename Q::handle> live;
+	for (int i = 0; i < population; i++) {
+		live.push_back(queue.push(bench_event{delay(rng), i}));
+	}
+
+	auto start = clock_type::now();
+	for (int i = 0; i < iterations; i++) {
+		if (coin(rng) < ratio) {
+			int id = pick(rng);
+			if (lazy) {
+				queue.cancel(live[id]);
+			} else {
+				queue.pop(live[id]);
+			}
+			live[id] = queue.push(bench_event{queue.now + delay(rng), id});
+		} else {
+			bench_event e = queue.pop();
+			live[e.id] = queue.push(bench_event{e.time + delay(rng), e.id});
+		}
+	}
+	auto stop = clock_type::now();
+	return std::chrono::duration<double, std::nano>(stop - start).count() / (double)iterations;
+}
+
+void bench_cancel() {
+	const int iterations = 1000000;
+	const int population = 10000;
+
+	printf("cancel: %d events, delays up to 2^14\n", population);
+	printf("%10s %16s %16s\n", "ratio", "eager ns/op", "lazy ns/op");
+	for (double ratio = 0.5; ratio < 0.96; ratio += 0.15) {
+		calendar_queue<bench_event, bench_priority, day_bitmap, arena_events<bench_event> > eager;
+		calendar_queue<bench_event, bench_priority, day_bitmap, arena_events<bench_event> > lazy;
+		double t0 = cancel_churn(eager, false, population, iterations, ratio, 1ul<<14, 1);
+		double t1 = cancel_churn(lazy, true, population, iterations, ratio, 1ul<<14, 1);
+		printf("%10.2f %16.1f %16.1f\n", ratio, t0, t1);
+	}
+}
+
+// Population that swings back and forth across a resize threshold. Reports
+// the mean, 99.99th percentile, and worst single operation along with the number of resizes so
+// that the default policy, a wider hysteresis band, and incremental migration
+// can be compared. The first cycle only warms up event storage.
+template <typename Q>
+void swing(const char *name, Q &queue, int low, int high, int cycles) {
+	std::mt19937_64 rng(3);
+	std::uniform_int_distribution<uint64_t> delay(1u, 1u << 14);
+
+	for (int i = 0; i < low; i++) {
+		queue.push(bench_event{delay(rng), i});
+	}
+
+	std::vector<double> times;
+	uint64_t now = 0;
+	for (int c = 0; c < cycles; c++) {
+		for (int i = low; i < high; i++) {
+			auto start = clock_type::now();
+			queue.push(bench_event{now + delay(rng), i});
+			double t = std::chrono::duration<double, std::nano>(clock_type::now() - start).count();
+			if (c > 0) {
+				times.push_back(t);
+			}
+		}
+		for (int i = low; i < high; i++) {
+			auto start = clock_type::now();
+			now = queue.pop().time;
+			double t = std::chrono::duration<double, std::nano>(clock_type::now() - start).count();
+			if (c > 0) {
+				times.push_back(t);
+			}
+		}
+	}
+	double total = 0.0;
+	for (auto t = times.begin(); t != times.end(); t++) {
+		total += *t;
+	}
+	std::sort(times.begin(), times.end());
+	double tail = times[times.size() - times.size()/10000 - 1];
+	printf("%24s %12.1f %12.0f %12.0f %8lu %8lu\n", name, total / (double)times.size(), tail, times.back(), (unsigned long)queue.grows, (unsigned long)queue.shrinks);
+}
+
+void bench_resize() {
+	using Q = calendar_queue<bench_event, bench_priority, day_bitmap, arena_events<bench_event> >;
+	const int low = 20000;
+	const int high = 70000;
+	const int cycles = 21;
+
+	printf("resize: population swinging between %d and %d\n", low, high);
+	printf("%24s %12s %12s %12s %8s %8s\n", "policy", "mean ns/op", "p99.99 ns", "worst ns", "grows", "shrinks");
+	Q eager(20, 4, bench_priority(), resize_policy(1, 1, 0));
+	swing("grow 1, shrink 1", eager, low, high, cycles);
+	Q damped(20, 4, bench_priority(), resize_policy(2, 2, 0));
+	swing("grow 2, shrink 2", damped, low, high, cycles);
+	Q incremental(20, 4, bench_priority(), resize_policy(1, 1, 4));
+	swing("incremental, 4 days/op", incremental, low, high, cycles);
+	Q both(20, 4, bench_priority(), resize_policy(2, 2, 4));
+	swing("both", both, low, high, cycles);
+}
+
+// Mean number of events per occupied day, and the mean length of the day
+// each event sits in, which is what add() walks when inserting into it.
+template <typename Q>
+void occupancy(Q &queue, double &per_day, double &scan) {
+	uint64_t occupied = 0;
+	uint64_t total = 0;
+	uint64_t squares = 0;
+	for (auto d = queue.calendar.begin(); d != queue.calendar.end(); d++) {
+		uint64_t n = 0;
+		for (auto e = d->first; e != Q::nil; e = queue.events[e].next) {
+			n++;
+		}
+		occupied += n > 0 ? 1 : 0;
+		total += n;
+		squares += n*n;
+	}
+	per_day = occupied > 0 ? (double)total / (double)occupied : 0.0;
+	scan = total > 0 ? (double)squares / (double)total : 0.0;
+}
+
+// Churn with delay scales that differ by orders of magnitude, as they do
+// between circuits with different delay_max values. The fixed queue keeps the
+// simulator's default 2^10 day width while the adaptive one picks its width
+// from the sampled gaps.
+void bench_width() {
+	using Q = calendar_queue<bench_event, bench_priority, day_bitmap, arena_events<bench_event> >;
+	const int population = 1000;
+	const int iterations = 500000;
+
+	printf("day width: %d events\n", population);
+	printf("%12s %28s %28s\n", "", "fixed (14, 4)", "adaptive");
+	printf("%12s %8s %9s %9s %8s %9s %9s %5s\n", "max delay", "ns/op", "ev/day", "scan", "ns/op", "ev/day", "scan", "day");
+	for (int scale = 4; scale <= 28; scale += 4) {
+		Q fixed(14, 4);
+		Q adaptive(14, 4, bench_priority(), resize_policy(1, 1, 0, true));
+		double t0 = churn(fixed, population, iterations, 1ul<<scale, 1);
+		double t1 = churn(adaptive, population, iterations, 1ul<<scale, 1);
+		double d0, s0, d1, s1;
+		occupancy(fixed, d0, s0);
+		occupancy(adaptive, d1, s1);
+		printf("%12s %8.1f %9.2f %9.2f %8.1f %9.2f %9.2f %5d\n", ("2^" + std::to_string(scale)).c_str(), t0, d0, s0, t1, d1, s1, adaptive.day);
+	}
+}
+
+// The simulator's two queue backends across population sizes, with delays
+// on the scale of the simulator's default delay_max.
+void bench_backend() {
+	using calendar = calendar_queue<bench_event, bench_priority, day_bitmap, arena_events<bench_event> >;
+	using radix = radix_heap<bench_event, bench_priority>;
+	const int iterations = 1000000;
+
+	printf("backend: delays up to 2^14\n");
+	printf("%10s %18s %18s\n", "events", "calendar ns/op", "radix ns/op");
+	for (int population = 4; population <= (1 << 20); population *= 8) {
+		calendar q0(14, 4, bench_priority(), resize_policy(1, 1, 0, true));
+		radix q1;
+		double t0 = churn(q0, population, iterations, 1u << 14, 1);
+		double t1 = churn(q1, population, iterations, 1u << 14, 1);
+		printf("%10d %18.1f %18.1f\n", population, t0, t1);
+	}
+}
+
+int main(int argc, char **argv) {
+	bench_next();
+	bench_storage();
+	bench_cancel();
+	bench_resize();
+	bench_width();
+	bench_backend();
+	return 0;
+}
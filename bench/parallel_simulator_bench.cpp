@@ -0,0 +1,105 @@
+#include <prs/production_rule.h>
+#include <prs/simulator.h>
+#include <prs/parallel_simulator.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <stdio.h>
+
+// Compares the throughput of the event driven simulator, which runs one
+// input vector at a time, against the bit-parallel simulator at 64 and 256
+// lanes. The circuit is a random layered network of two input NAND gates.
+
+using namespace prs;
+
+using clock_type = std::chrono::steady_clock;
+
+production_rule_set nand_network(int inputs, int layers, int width, vector<int> &in, vector<int> &out) {
+	std::mt19937 g(5);
+
+	production_rule_set pr;
+	int vdd = pr.create(net("Vdd", 0, true, true));
+	int gnd = pr.create(net("GND", 0, true, true));
+	pr.set_power(vdd, gnd);
+
+	in.clear();
+	for (int i = 0; i < inputs; i++) {
+		in.push_back(pr.create(net("i" + std::to_string(i), 0, false, true)));
+	}
+
+	vector<int> prev = in;
+	for (int l = 0; l < layers; l++) {
+		std::uniform_int_distribution<int> pick(0, (int)prev.size()-1);
+		vector<int> curr;
+		for (int i = 0; i < width; i++) {
+			int a = prev[pick(g)];
+			int b = prev[pick(g)];
+			int y = pr.create(net("n" + std::to_string(l) + "_" + std::to_string(i)));
+			pr.add(gnd, boolean::cover(boolean::cube(a, 1) & boolean::cube(b, 1)), y, 0);
+			pr.add(vdd, boolean::cover(a, 0) | boolean::cover(b, 0), y, 1);
+			curr.push_back(y);
+		}
+		prev = curr;
+	}
+	out = prev;
+	return pr;
+}
+
+// ns per input vector applied and settled with the event driven simulator
+double serial(const production_rule_set &pr, const vector<int> &in, int vectors) {
+	std::mt19937 g(7);
+	simulator sim(&pr);
+	sim.reset();
+
+	auto start = clock_type::now();
+	for (int v = 0; v < vectors; v++) {
+		for (auto i = in.begin(); i != in.end(); i++) {
+			sim.set(*i, (int)(g()&1));
+		}
+		while (not sim.enabled.empty()) {
+			sim.fire();
+		}
+	}
+	auto stop = clock_type::now();
+	return std::chrono::duration<double, std::nano>(stop - start).count() / (double)vectors;
+}
+
+// ns per input vector with S::width vectors applied and settled at once
+template <typename S>
+double parallel(const production_rule_set &pr, const vector<int> &in, int vectors) {
+	std::mt19937_64 g(7);
+	S sim(&pr);
+	sim.reset();
+
+	int rounds = (vectors + S::width - 1) / S::width;
+	auto start = clock_type::now();
+	for (int r = 0; r < rounds; r++) {
+		for (auto i = in.begin(); i != in.end(); i++) {
+			typename S::word bits;
+			for (auto w = bits.w.begin(); w != bits.w.end(); w++) {
+				*w = g();
+			}
+			sim.set(*i, bits, 1);
+			sim.set(*i, ~bits, 0);
+		}
+		sim.settle();
+	}
+	auto stop = clock_type::now();
+	return std::chrono::duration<double, std::nano>(stop - start).count() / (double)(rounds*S::width);
+}
+
+int main(int argc, char **argv) {
+	const int vectors = 20000;
+
+	printf("parallel simulator: random two input NAND networks, 32 inputs\n");
+	printf("%8s %8s %18s %18s %18s\n", "layers", "gates", "serial ns/vec", "64 lane ns/vec", "256 lane ns/vec");
+	for (int layers = 4; layers <= 64; layers *= 2) {
+		vector<int> in, out;
+		production_rule_set pr = nand_network(32, layers, 64, in, out);
+		double t0 = serial(pr, in, vectors/10);
+		double t1 = parallel<parallel_simulator>(pr, in, vectors);
+		double t2 = parallel<wide_parallel_simulator>(pr, in, vectors);
+		printf("%8d %8d %18.1f %18.1f %18.1f\n", layers, layers*64, t0, t1, t2);
+	}
+	return 0;
+}
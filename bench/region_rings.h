@@ -0,0 +1,94 @@
+#pragma once
+
+#include <prs/production_rule.h>
+#include <prs/simulator.h>
+#include <chrono>
+#include <string>
+
+// The circuit and timing loops shared by the multi-threaded simulator
+// benchmarks.
+
+using clock_type = std::chrono::steady_clock;
+
+// One bank of rings five stage ring oscillators per region. The first ring
+// of each region is gated by a stage of the previous region, so every worker
+// forwards changes to the next one. The transitions of region g take delay
+// plus g times skew, so a nonzero skew keeps the firing times of the regions
+// from lining up.
+inline prs::production_rule_set region_rings(int regions, int rings, int &enable, uint64_t delay, uint64_t skew=0) {
+	using namespace prs;
+	const int stages = 5;
+
+	production_rule_set pr;
+	int vdd = pr.create(net("Vdd", 0, true, true));
+	int gnd = pr.create(net("GND", 0, true, true));
+	pr.set_power(vdd, gnd);
+	enable = pr.netIndex("en", true);
+
+	string tap;
+	for (int g = 0; g < regions; g++) {
+		attributes attr;
+		attr.delay_max = delay + skew*g;
+
+		string suffix = "'" + std::to_string(g);
+		int en = pr.netIndex("en" + suffix, true);
+		for (int r = 0; r < rings; r++) {
+			vector<int> x;
+			for (int i = 0; i < stages; i++) {
+				x.push_back(pr.netIndex("x" + std::to_string(g) + "_" + std::to_string(r) + "_" + std::to_string(i) + suffix, true));
+			}
+
+			boolean::cube pulldown = boolean::cube(en, 1) & boolean::cube(x[stages-1], 1);
+			boolean::cover pullup = boolean::cover(en, 0) | boolean::cover(x[stages-1], 0);
+			if (r == 0 and not tap.empty()) {
+				int t = pr.netIndex(tap + suffix, true);
+				pulldown &= boolean::cube(t, 1);
+				pullup |= boolean::cover(t, 0);
+			}
+			pr.add(gnd, boolean::cover(pulldown), x[0], 0, attr);
+			pr.add(vdd, pullup, x[0], 1, attr);
+			for (int i = 1; i < stages; i++) {
+				pr.add(gnd, boolean::cover(x[i-1], 1), x[i], 0, attr);
+				pr.add(vdd, boolean::cover(x[i-1], 0), x[i], 1, attr);
+			}
+		}
+		tap = "x" + std::to_string(g) + "_0_2";
+	}
+	return pr;
+}
+
+// ms to run the oscillators for a fixed span of simulated time with the
+// sequential simulator::fire() loop, fixed delays
+inline double serial(const prs::production_rule_set &pr, int enable, uint64_t span) {
+	using namespace prs;
+	simulator sim(&pr);
+	sim.delay.policy = delay_model::fixed_max;
+	sim.reset();
+	sim.set(enable, 0);
+	while (not sim.enabled.empty()) {
+		sim.fire();
+	}
+	sim.set(enable, 1);
+
+	uint64_t until = sim.now + span;
+	auto start = clock_type::now();
+	while (not sim.enabled.empty() and sim.enabled[sim.enabled.next()].value.fire_at <= until) {
+		sim.fire();
+	}
+	auto stop = clock_type::now();
+	return std::chrono::duration<double, std::milli>(stop - start).count();
+}
+
+// ms for a region_simulator or time_warp_simulator to run the same span
+template <typename S>
+double parallel(S &sim, int enable, uint64_t span) {
+	sim.reset();
+	sim.set(enable, 0);
+	sim.advance();
+	sim.set(enable, 1);
+
+	auto start = clock_type::now();
+	sim.advance(sim.now + span);
+	auto stop = clock_type::now();
+	return std::chrono::duration<double, std::milli>(stop - start).count();
+}
@@ -0,0 +1,37 @@
+#include <prs/production_rule.h>
+#include <prs/simulator.h>
+#include <prs/region_simulator.h>
+#include <thread>
+#include <stdio.h>
+#include "region_rings.h"
+
+// Measures how the region simulator scales with worker threads. The
+// circuit has one bank of five stage ring oscillators per region, and the
+// first ring of each region is gated by a stage of the previous region, so
+// every worker forwards changes to the next one.
+
+using namespace prs;
+
+int main(int argc, char **argv) {
+	const int regions = 16;
+	const uint64_t span = 2000000;
+	int cores = (int)std::thread::hardware_concurrency();
+
+	printf("region simulator: %d regions of ring oscillators, %d hardware threads\n", regions, cores);
+	printf("%8s %14s", "rings", "serial ms");
+	for (int w = 1; w <= regions; w *= 2) {
+		printf(" %10s%-4d", "workers ", w);
+	}
+	printf("\n");
+	for (int rings = 16; rings <= 256; rings *= 4) {
+		int enable;
+		production_rule_set pr = region_rings(regions, rings, enable, 10000);
+		printf("%8d %14.1f", rings, serial(pr, enable, span));
+		for (int w = 1; w <= regions; w *= 2) {
+			region_simulator sim(&pr, w);
+			printf(" %14.1f", parallel(sim, enable, span));
+		}
+		printf("\n");
+	}
+	return 0;
+}
@@ -0,0 +1,128 @@
+#include <prs/production_rule.h>
+#include <prs/simulator.h>
+#include <prs/trace.h>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <stdio.h>
+
+// Compares the simulator's queue backends on generated circuits of
+// increasing size. Each circuit is a bank of independent five stage ring
+// oscillators that share an enable, so the number of pending events, and
+// with it the size of the queue, grows with the number of rings.
+
+using namespace prs;
+
+using clock_type = std::chrono::steady_clock;
+
+// Build rings five stage ring oscillators. Stage zero of each ring is a NAND
+// of the enable and the last stage so that every ring settles to a known
+// state while the enable is low.
+production_rule_set ring_bank(int rings, int &enable) {
+	const int stages = 5;
+
+	production_rule_set pr;
+	int vdd = pr.create(net("Vdd", 0, true, true));
+	int gnd = pr.create(net("GND", 0, true, true));
+	pr.set_power(vdd, gnd);
+	enable = pr.create(net("en", 0, false, true));
+
+	for (int r = 0; r < rings; r++) {
+		vector<int> x;
+		for (int i = 0; i < stages; i++) {
+			x.push_back(pr.create(net("x" + std::to_string(r) + "_" + std::to_string(i))));
+		}
+
+		pr.add(gnd, boolean::cover(boolean::cube(enable, 1) & boolean::cube(x[stages-1], 1)), x[0], 0);
+		pr.add(vdd, boolean::cover(enable, 0), x[0], 1);
+		pr.add(vdd, boolean::cover(x[stages-1], 0), x[0], 1);
+		for (int i = 1; i < stages; i++) {
+			pr.add(gnd, boolean::cover(x[i-1], 1), x[i], 0);
+			pr.add(vdd, boolean::cover(x[i-1], 0), x[i], 1);
+		}
+	}
+	return pr;
+}
+
+// Settle the circuit with the enable low, then raise it and time the
+// firings of the free running oscillators, recording every change into
+// tracer if it is set.
+template <typename S>
+double oscillate(const production_rule_set &pr, int enable, int fires, trace_writer *tracer=nullptr) {
+	S sim(&pr);
+	sim.tracer = tracer;
+	sim.reset();
+	sim.set(enable, 0);
+	while (not sim.enabled.empty()) {
+		sim.fire();
+	}
+
+	sim.set(enable, 1);
+	auto start = clock_type::now();
+	for (int i = 0; i < fires and not sim.enabled.empty(); i++) {
+		sim.fire();
+	}
+	auto stop = clock_type::now();
+	return std::chrono::duration<double, std::nano>(stop - start).count() / (double)fires;
+}
+
+// Time assume() with a one literal cube on the last net of the circuit,
+// which holds its current value so that nothing is cancelled. The cube is
+// as long as the circuit is wide, but each word of unconstrained nets before
+// the literal is skipped with a single test.
+double assume_last(const production_rule_set &pr, int enable, int calls) {
+	simulator sim(&pr);
+	sim.reset();
+	sim.set(enable, 0);
+	while (not sim.enabled.empty()) {
+		sim.fire();
+	}
+
+	int last = pr.netCount()-1;
+	boolean::cube c(last, sim.encoding.get(last));
+	auto start = clock_type::now();
+	for (int i = 0; i < calls; i++) {
+		sim.assume(c);
+	}
+	auto stop = clock_type::now();
+	return std::chrono::duration<double, std::nano>(stop - start).count() / (double)calls;
+}
+
+int main(int argc, char **argv) {
+	const int fires = 200000;
+
+	printf("simulator: five stage ring oscillators sharing an enable\n");
+	printf("%10s %10s %22s %22s\n", "rings", "nets", "calendar ns/fire", "radix ns/fire");
+	for (int rings = 1; rings <= 4096; rings *= 4) {
+		int enable = 0;
+		production_rule_set pr = ring_bank(rings, enable);
+		double t0 = oscillate<simulator>(pr, enable, fires);
+		double t1 = oscillate<radix_simulator>(pr, enable, fires);
+		printf("%10d %10d %22.1f %22.1f\n", rings, pr.netCount(), t0, t1);
+	}
+
+	string path = (std::filesystem::temp_directory_path() / "simulator_bench.prst").string();
+	printf("\nfire() with and without a trace_writer, waiting when its ring is full\n");
+	printf("%10s %10s %22s %22s\n", "rings", "nets", "untraced ns/fire", "traced ns/fire");
+	for (int rings = 1; rings <= 4096; rings *= 4) {
+		int enable = 0;
+		production_rule_set pr = ring_bank(rings, enable);
+		double t0 = oscillate<simulator>(pr, enable, fires);
+		trace_writer writer;
+		writer.open(&pr, path);
+		double t1 = oscillate<simulator>(pr, enable, fires, &writer);
+		writer.close();
+		printf("%10d %10d %22.1f %22.1f\n", rings, pr.netCount(), t0, t1);
+	}
+	std::filesystem::remove(path);
+
+	const int calls = 1000000;
+	printf("\nassume(): one literal on the last net\n");
+	printf("%10s %10s %22s\n", "rings", "nets", "ns/call");
+	for (int rings = 1; rings <= 4096; rings *= 4) {
+		int enable = 0;
+		production_rule_set pr = ring_bank(rings, enable);
+		printf("%10d %10d %22.1f\n", rings, pr.netCount(), assume_last(pr, enable, calls));
+	}
+	return 0;
+}
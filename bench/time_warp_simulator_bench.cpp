@@ -0,0 +1,43 @@
+#include <prs/production_rule.h>
+#include <prs/simulator.h>
+#include <prs/region_simulator.h>
+#include <prs/time_warp_simulator.h>
+#include <thread>
+#include <stdio.h>
+#include "region_rings.h"
+
+// Compares the time warp simulator against a single simulator and against
+// the lock step region simulator. The circuit has one bank of five stage
+// ring oscillators per region. The first ring of each region is gated by a
+// stage of the previous region, and every region runs at its own delay, so
+// the firing times of the workers rarely line up and the lock step
+// simulator synchronizes at almost every event.
+
+using namespace prs;
+
+int main(int argc, char **argv) {
+	const int regions = 8;
+	const uint64_t span = 2000000;
+	int cores = (int)std::thread::hardware_concurrency();
+
+	printf("time warp simulator: %d regions of ring oscillators, %d hardware threads\n", regions, cores);
+	printf("%8s %8s %14s %14s %14s %12s\n", "rings", "workers", "serial ms", "lock step ms", "time warp ms", "rollbacks");
+	for (int rings = 16; rings <= 256; rings *= 4) {
+		int enable;
+		production_rule_set pr = region_rings(regions, rings, enable, 1000, 37);
+		double base = serial(pr, enable, span);
+		for (int w = 2; w <= regions; w *= 2) {
+			region_simulator lock(&pr, w);
+			time_warp_simulator warp(&pr, w);
+			double locked = parallel(lock, enable, span);
+			double warped = parallel(warp, enable, span);
+
+			uint64_t rollbacks = 0;
+			for (auto k = warp.warp.begin(); k != warp.warp.end(); k++) {
+				rollbacks += k->rollbacks;
+			}
+			printf("%8d %8d %14.1f %14.1f %14.1f %12lu\n", rings, w, base, locked, warped, (unsigned long)rollbacks);
+		}
+	}
+	return 0;
+}
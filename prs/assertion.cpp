@@ -0,0 +1,147 @@
+#include "assertion.h"
+
+#include <algorithm>
+
+namespace prs {
+
+violation::violation() {
+	time = 0;
+	property = -1;
+	net = -1;
+	value = 2;
+}
+
+violation::violation(uint64_t time, int property, int net, int value) {
+	this->time = time;
+	this->property = property;
+	this->net = net;
+	this->value = value;
+}
+
+violation::~violation() {
+}
+
+property::property() {
+	kind = invariant;
+	inverted = false;
+}
+
+property::property(int kind, string name, vector<int> nets) {
+	this->kind = kind;
+	this->name = name;
+	this->nets = nets;
+	this->inverted = false;
+}
+
+property::~property() {
+}
+
+assertions::assertions() {
+}
+
+assertions::~assertions() {
+}
+
+int assertions::add(property p) {
+	sort(p.nets.begin(), p.nets.end());
+	p.nets.erase(unique(p.nets.begin(), p.nets.end()), p.nets.end());
+	if (p.kind == property::handshake and p.nets.size() != 2) {
+		// a handshake with itself can never complete
+		return -1;
+	}
+
+	int id = (int)props.size();
+	for (int net : p.nets) {
+		if (net >= (int)index.size()) {
+			index.resize(net+1);
+		}
+		index[net].push_back(id);
+	}
+	props.push_back(p);
+	return id;
+}
+
+int assertions::invariant(string name, const boolean::cover &expr) {
+	property p(property::invariant, name, vector<int>());
+	for (auto c = expr.cubes.begin(); c != expr.cubes.end(); c++) {
+		p.expr.push_back(sparse_cube(*c));
+		for (auto l = p.expr.back().begin(); l != p.expr.back().end(); l++) {
+			p.nets.push_back(l->var);
+		}
+	}
+	return add(p);
+}
+
+int assertions::mutex(string name, vector<int> nets) {
+	return add(property(property::mutex, name, nets));
+}
+
+int assertions::handshake(string name, int req, int ack, bool inverted) {
+	property p(property::handshake, name, vector<int>({req, ack}));
+	p.inverted = inverted;
+	int id = add(p);
+	if (id >= 0) {
+		// add() sorts the nets, so put the request first again
+		props[id].nets = vector<int>({req, ack});
+	}
+	return id;
+}
+
+bool assertions::holds(int p, const boolean::cube &encoding, int net) const {
+	const property &prop = props[p];
+	switch (prop.kind) {
+	case property::invariant:
+		for (auto c = prop.expr.begin(); c != prop.expr.end(); c++) {
+			bool sat = true;
+			for (auto l = c->begin(); l != c->end() and sat; l++) {
+				sat = encoding.get(l->var) == l->val;
+			}
+			if (sat) {
+				return true;
+			}
+		}
+		return false;
+	case property::mutex: {
+		int high = 0;
+		for (int n : prop.nets) {
+			high += (int)(encoding.get(n) == 1);
+		}
+		return high <= 1;
+	}
+	case property::handshake: {
+		int req = encoding.get(prop.nets[0]);
+		int ack = encoding.get(prop.nets[1]);
+		if (req < 0 or req > 1 or ack < 0 or ack > 1) {
+			return true;
+		}
+		if (prop.inverted) {
+			ack = 1-ack;
+		}
+		// The changing side must now differ from (request) or match
+		// (acknowledge) the other side
+		return net == prop.nets[0] ? req != ack : req == ack;
+	}
+	}
+	return true;
+}
+
+void assertions::check(const boolean::cube &encoding, int net, uint64_t time) {
+	if (net >= (int)index.size()) {
+		return;
+	}
+	for (int p : index[net]) {
+		if (not holds(p, encoding, net)) {
+			violations.push_back(violation(time, p, net, encoding.get(net)));
+		}
+	}
+}
+
+void assertions::clear() {
+	violations.clear();
+}
+
+string assertions::to_string(const violation &v, const production_rule_set *base) const {
+	return "@" + std::to_string(v.time) + " " + props[v.property].name + " violated by " + base->netAt(v.net) + (v.value == 1 ? "+" : (v.value == 0 ? "-" : "~"));
+}
+
+}
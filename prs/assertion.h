@@ -0,0 +1,83 @@
+#pragma once
+
+#include "production_rule.h"
+#include "sparse_cube.h"
+#include <common/standard.h>
+#include <boolean/cover.h>
+
+namespace prs {
+
+// A property found to be false, and the change that made it so
+struct violation {
+	violation();
+	violation(uint64_t time, int property, int net, int value);
+	~violation();
+
+	uint64_t time;  // simulation time of the change
+	int property;   // index into assertions::props
+	int net;        // the net that changed
+	int value;      // its new value
+};
+
+// A property of the state of a circuit
+struct property {
+	enum {
+		invariant = 0,  // expr holds in every state
+		mutex = 1,      // at most one of nets is high
+		handshake = 2   // nets[0] and nets[1] follow a four phase handshake
+	};
+
+	property();
+	property(int kind, string name, vector<int> nets);
+	~property();
+
+	int kind;
+	string name;
+	// The nets the property reads. For a handshake these are the request
+	// and the acknowledge.
+	vector<int> nets;
+	// For an invariant, the cubes of its cover
+	vector<sparse_cube> expr;
+	// For a handshake, whether the acknowledge is active low, like an enable
+	bool inverted;
+};
+
+// Checks properties of the state of a simulator as it changes. Each
+// property is indexed by the nets it reads, and the simulator calls check()
+// for every net it sets, so only the properties that read a net are
+// evaluated when it changes, and the cost of checking follows activity
+// rather than the size of the circuit.
+//
+// A handshake needs no state of its own. The request may only change to the
+// opposite of the acknowledge, and the acknowledge may only change to match
+// the request, which orders req+ ack+ req- ack- in that cycle. A handshake
+// is not checked while either net is unknown or unstable, so that it may be
+// registered before reset. An invariant is checked on every change, and a
+// literal of it on an unknown net is false.
+struct assertions {
+	assertions();
+	~assertions();
+
+	vector<property> props;
+	// The properties that read each net
+	vector<vector<int> > index;
+
+	vector<violation> violations;
+
+	// Each returns the index of the new property in props
+	int invariant(string name, const boolean::cover &expr);
+	int mutex(string name, vector<int> nets);
+	int handshake(string name, int req, int ack, bool inverted=false);
+
+	// Check the properties that read net after it changed in encoding
+	void check(const boolean::cube &encoding, int net, uint64_t time);
+	// Whether property p holds in encoding
+	bool holds(int p, const boolean::cube &encoding, int net) const;
+
+	void clear();
+	string to_string(const violation &v, const production_rule_set *base) const;
+
+	int add(property p);
+};
+
+}
@@ -4,6 +4,9 @@
 #include <vector>
 #include <stdint.h>
 #include <limits>
+#include <bit>
+#include <algorithm>
+#include <array>
 
 #include <stdio.h>
 
@@ -14,13 +17,114 @@ struct default_priority {
 	}
 };
 
-template <typename T, typename P=default_priority<T> >
-struct calendar_queue {
+// The order of events that have the same time. A priority may define
+// tie(value) to order them. Among events with the same time and tie,
+// calendar_queue puts the most recently pushed first, and radix_heap keeps no
+// particular order.
+template <typename P, typename T>
+uint64_t priority_tie(P &priority, const T &value) {
+	if constexpr (requires { priority.tie(value); }) {
+		return priority.tie(value);
+	} else {
+		return 0;
+	}
+}
+
+// Default day index for calendar_queue. It does not track which days are
+// occupied, so next() visits every day bucket between the current day and the
+// end of the calendar.
+struct day_scan {
+	void resize(uint64_t days) {
+	}
+
+	void mark(uint64_t day) {
+	}
+
+	void unmark(uint64_t day) {
+	}
+
+	// return the first day in [from, to) that might hold events, or to
+	uint64_t find(uint64_t from, uint64_t to) {
+		return from;
+	}
+};
+
+// Two level occupancy bitmap over the days of a calendar_queue. Bit d of
+// days is set when day d holds at least one event, and bit w of weeks is set
+// when days[w] is non-zero. next() then skips runs of empty days with a count
+// trailing zeros per 64 days (or per 4096 days at the upper level) instead of
+// walking each bucket.
+struct day_bitmap {
+	std::vector<uint64_t> days;
+	std::vector<uint64_t> weeks;
+
+	void resize(uint64_t n) {
+		days.assign((n+63)>>6, 0ul);
+		weeks.assign((days.size()+63)>>6, 0ul);
+	}
+
+	// Make room for n days, keeping the days already marked
+	void grow(uint64_t n) {
+		days.resize((n+63)>>6, 0ul);
+		weeks.resize((days.size()+63)>>6, 0ul);
+	}
+
+	void mark(uint64_t day) {
+		days[day>>6] |= 1ul<<(day&63);
+		weeks[day>>12] |= 1ul<<((day>>6)&63);
+	}
+
+	bool marked(uint64_t day) const {
+		return (days[day>>6]>>(day&63))&1;
+	}
+
+	void unmark(uint64_t day) {
+		days[day>>6] &= ~(1ul<<(day&63));
+		if (days[day>>6] == 0) {
+			weeks[day>>12] &= ~(1ul<<((day>>6)&63));
+		}
+	}
+
+	uint64_t find(uint64_t from, uint64_t to) {
+		if (from >= to) {
+			return to;
+		}
+
+		uint64_t w = from>>6;
+		uint64_t bits = days[w] & (~0ul<<(from&63));
+		if (bits != 0) {
+			from = (w<<6) + std::countr_zero(bits);
+			return from < to ? from : to;
+		}
+
+		// search the upper level for the next non-empty word of days
+		w++;
+		for (uint64_t k = w>>6; k < weeks.size() and (k<<12) < to; k++) {
+			bits = weeks[k];
+			if (k == (w>>6)) {
+				bits &= ~0ul<<(w&63);
+			}
+			if (bits != 0) {
+				w = (k<<6) + std::countr_zero(bits);
+				from = (w<<6) + std::countr_zero(days[w]);
+				return from < to ? from : to;
+			}
+		}
+		return to;
+	}
+};
+
+// Default event storage for calendar_queue. Events live in a std::deque so
+// that their addresses never change, and they are linked with raw pointers.
+// Copying the storage has to rewrite every link.
+template <typename T>
+struct deque_events {
 	struct event {
 		event(size_t index) {
 			next = nullptr;
 			prev = nullptr;
 			this->index = index;
+			this->gen = 0;
 		}
 
 		~event() {
@@ -28,75 +132,317 @@ struct calendar_queue {
 
 		T value;
 		size_t index;
+		uint32_t gen;
 
 		event *next;
 		event *prev;
 	};
 
+	using handle = event*;
+	static constexpr handle nil = nullptr;
+
+	std::deque<event> pool;
+	event *unused;
+
+	deque_events() {
+		unused = nullptr;
+	}
+
+	deque_events(const deque_events &s) {
+		*this = s;
+	}
+
+	~deque_events() {
+	}
+
+	deque_events &operator=(const deque_events &s) {
+		pool = s.pool;
+		for (auto e = pool.begin(); e != pool.end(); e++) {
+			e->next = rebase(e->next, s);
+			e->prev = rebase(e->prev, s);
+		}
+		unused = rebase(s.unused, s);
+		return *this;
+	}
+
+	// translate a handle into s to the equivalent handle into this copy
+	handle rebase(handle h, const deque_events &s) {
+		return h == nullptr ? nullptr : &pool[h->index];
+	}
+
+	event &operator[](handle h) {
+		return *h;
+	}
+
+	handle alloc() {
+		handle result = unused;
+		if (result != nullptr) {
+			unused = result->next;
+			result->next = nullptr;
+		} else {
+			pool.push_back(event(pool.size()));
+			result = &pool.back();
+		}
+		return result;
+	}
+
+	void free(handle h) {
+		h->next = unused;
+		h->prev = nullptr;
+		unused = h;
+	}
+
+	size_t size() const {
+		return pool.size();
+	}
+
+	void clear() {
+		pool.clear();
+		unused = nullptr;
+	}
+};
+
+// Contiguous event storage for calendar_queue. Events live in a single
+// std::vector and are linked with 32 bit indices, so a copy of the storage is
+// a plain copy of the vector and the links stay valid. Handles are indices,
+// which remain valid as the arena grows, but references into the arena do
+// not.
+template <typename T>
+struct arena_events {
+	enum class handle : uint32_t {};
+	static constexpr handle nil = handle(std::numeric_limits<uint32_t>::max());
+
+	struct event {
+		T value;
+		uint32_t gen;
+
+		handle next;
+		handle prev;
+	};
+
+	std::vector<event> pool;
+	handle unused;
+
+	arena_events() {
+		unused = nil;
+	}
+
+	~arena_events() {
+	}
+
+	handle rebase(handle h, const arena_events &s) {
+		return h;
+	}
+
+	event &operator[](handle h) {
+		return pool[(uint32_t)h];
+	}
+
+	handle alloc() {
+		handle result = unused;
+		if (result != nil) {
+			unused = pool[(uint32_t)result].next;
+			pool[(uint32_t)result].next = nil;
+		} else {
+			result = handle((uint32_t)pool.size());
+			pool.push_back(event{T(), 0, nil, nil});
+		}
+		return result;
+	}
+
+	void free(handle h) {
+		pool[(uint32_t)h].next = unused;
+		pool[(uint32_t)h].prev = nil;
+		unused = h;
+	}
+
+	size_t size() const {
+		return pool.size();
+	}
+
+	void clear() {
+		pool.clear();
+		unused = nil;
+	}
+};
+
+// Controls when and how a calendar_queue changes its number of days. The
+// calendar grows when it holds more than days<<grow events and shrinks when
+// it holds fewer than days>>shrink, so larger shifts widen the hysteresis
+// band between the two and keep a population that hovers near one threshold
+// from resizing back and forth.
+//
+// If migrate is zero, a resize re-buckets every event at once. Otherwise the
+// old calendar is kept alongside the new one, and each push or pop moves up
+// to migrate non-empty days of the old calendar into the new one, spreading
+// the cost of the resize over many operations.
+//
+// If adapt is set, the day width is no longer fixed by the year and the
+// number of events. Instead, the queue samples the gaps between events popped
+// from the head and picks a width of about three times their mean, as in
+// Brown's original calendar queue. The year then stretches or shrinks so that
+// the number of days still tracks the number of events.
+struct resize_policy {
+	resize_policy(int grow=1, int shrink=1, uint64_t migrate=0, bool adapt=false) {
+		this->grow = grow;
+		this->shrink = shrink;
+		this->migrate = migrate;
+		this->adapt = adapt;
+	}
+
+	~resize_policy() {
+	}
+
+	int grow;
+	int shrink;
+	uint64_t migrate;
+	bool adapt;
+};
+
+// A calendar queue sorts events into day buckets by their priority (time).
+// Each bucket is a sorted doubly linked list, and the calendar wraps around
+// once per year. The number of days grows and shrinks with the number of
+// queued events.
+//
+// O selects the day index used by next() to find the next non-empty bucket,
+// either day_scan (linear search) or day_bitmap (count trailing zeros).
+//
+// S selects the event storage, either deque_events (stable pointers) or
+// arena_events (contiguous storage with 32 bit index links). Handles
+// returned by push() and next() are S::handle, and the event they refer to
+// is found with operator[].
+//
+// Events may be removed eagerly with pop(e), which unlinks them immediately,
+// or lazily with cancel(e), which only marks them as tombstones. Every event
+// carries a generation counter that is odd while the event is a tombstone
+// and advances whenever the event is cancelled or released, so a handle
+// saved with its generation can detect that its event is gone. Tombstones
+// are skipped by next() and unlinked when the calendar is resized or when
+// they make up more than half of the linked events.
+template <typename T, typename P=default_priority<T>, typename O=day_scan, typename S=deque_events<T> >
+struct calendar_queue {
+	using event = typename S::event;
+	using handle = typename S::handle;
+	using days_t = std::vector<std::pair<handle, handle> >;
+	static constexpr handle nil = S::nil;
+
 	P priority;
+	resize_policy policy;
 
-	uint64_t count;
+	uint64_t count; // linked events, including tombstones
+	uint64_t tombs; // cancelled events that are still linked
 	uint64_t now;
 
-	std::deque<event> events;
-	event *unused;
+	S events;
 
-	std::vector<std::pair<event*, event*> > calendar;
+	days_t calendar;
+	O occupied;
+
+	// During an incremental resize, days of the old calendar are moved to the
+	// new one in order starting from the day of first, which is the current
+	// day when the resize starts. The first cursor days from there, wrapping
+	// around the end of the old calendar, have been moved. old is empty when
+	// no resize is in progress.
+	days_t old;
+	O old_occupied;
+	int old_day;
+	int old_year;
+	uint64_t first;
+	uint64_t cursor;
 
 	// bit shift amounts
 	int year;
 	int day;
 	int mindiff;
 
-	calendar_queue(int year=14, int mindiff=4, P priority=P()) {
+	// number of times the calendar has grown or shrunk, and the number of
+	// times an adaptive policy has changed the day width
+	uint64_t grows;
+	uint64_t shrinks;
+	uint64_t retunes;
+
+	// Gaps between the times of events popped from the head, kept for an
+	// adaptive policy. sampled counts every gap ever recorded and last is
+	// the time of the most recent event popped from the head.
+	std::array<uint64_t, 64> gaps;
+	uint64_t sampled;
+	uint64_t last;
+
+	// Sort buffer for push_batch(), kept to reuse its storage
+	struct batch_entry {
+		uint64_t time;
+		uint64_t day;
+		uint64_t tie;
+		size_t index;
+		handle e;
+	};
+	std::vector<batch_entry> batch_order;
+
+	calendar_queue(int year=14, int mindiff=4, P priority=P(), resize_policy policy=resize_policy()) {
 		this->count = 0;
+		this->tombs = 0;
 		this->now = std::numeric_limits<uint64_t>::max();
 		this->mindiff = mindiff;
 		this->year = year;
 		this->day = year < mindiff ? 0 : year-mindiff;
 		this->priority = priority;
-		this->unused = nullptr;
-		calendar.resize(days(), std::pair<event*, event*>(nullptr, nullptr));
+		this->policy = policy;
+		this->old_day = this->day;
+		this->old_year = this->year;
+		this->first = 0;
+		this->cursor = 0;
+		this->grows = 0;
+		this->shrinks = 0;
+		this->retunes = 0;
+		this->gaps.fill(0);
+		this->sampled = 0;
+		this->last = std::numeric_limits<uint64_t>::max();
+		calendar.resize(days(), std::pair<handle, handle>(nil, nil));
+		occupied.resize(days());
 	}
 
 	calendar_queue(const calendar_queue &q) {
+		*this = q;
+	}
+
+	// Copy the events and translate every day's links into the copy, so the
+	// two queues share nothing
+	calendar_queue &operator=(const calendar_queue &q) {
+		priority = q.priority;
+		policy = q.policy;
 		count = q.count;
+		tombs = q.tombs;
 		now = q.now;
 		events = q.events;
-		for (auto e = events.begin(); e != events.end(); e++) {
-			if (e->next != nullptr) {
-				e->next = &events[e->next->index];
-			}
-			if (e->prev != nullptr) {
-				e->prev = &events[e->prev->index];
-			}
-		}
-		unused = nullptr;
-		if (q.unused != nullptr) {
-			unused = &events[q.unused->index];
-			unused->prev = nullptr;
-		}
-		event u = unused;
-		for (event *e = q.unused->next; e != nullptr; e = e->next) {
-			u->next = &events[e->index];
-			u->next->prev = u;
-			u = u->next;
-		}
-		u->next = nullptr;
 
 		calendar = q.calendar;
 		for (auto d = calendar.begin(); d != calendar.end(); d++) {
-			if (d->first != nullptr) {
-				d->first = &events[d->first->index];
-			}
-			if (d->second != nullptr) {
-				d->second = &events[d->second->index];
-			}
+			d->first = events.rebase(d->first, q.events);
+			d->second = events.rebase(d->second, q.events);
 		}
+		occupied = q.occupied;
+
+		old = q.old;
+		for (auto d = old.begin(); d != old.end(); d++) {
+			d->first = events.rebase(d->first, q.events);
+			d->second = events.rebase(d->second, q.events);
+		}
+		old_occupied = q.old_occupied;
+		old_day = q.old_day;
+		old_year = q.old_year;
+		first = q.first;
+		cursor = q.cursor;
 
 		year = q.year;
 		day = q.day;
 		mindiff = q.mindiff;
+		grows = q.grows;
+		shrinks = q.shrinks;
+		retunes = q.retunes;
+		gaps = q.gaps;
+		sampled = q.sampled;
+		last = q.last;
+		return *this;
 	}
 
 	~calendar_queue() {
@@ -118,91 +464,301 @@ struct calendar_queue {
 		return (1ul<<(year-day));
 	}
 
+	uint64_t olddayof(uint64_t time) {
+		return (time>>old_day)&((1ul<<(old_year-old_day))-1ul);
+	}
+
+	// whether an event at this time is still in the old calendar of an
+	// incremental resize
+	bool unmigrated(uint64_t time) {
+		return not old.empty() and ((olddayof(time)-first)&(old.size()-1)) >= cursor;
+	}
+
+	// rebuild the day index after the calendar has been resized
+	void reindex() {
+		occupied.resize(calendar.size());
+		for (uint64_t d = 0; d < calendar.size(); d++) {
+			if (calendar[d].first != nil) {
+				occupied.mark(d);
+			}
+		}
+	}
+
+	bool dead(handle e) {
+		return (events[e].gen&1) != 0;
+	}
+
+	// unlink and release every tombstone
+	void compact() {
+		finish();
+		for (uint64_t d = occupied.find(0, calendar.size()); d < calendar.size() and tombs > 0; d = occupied.find(d+1, calendar.size())) {
+			handle e = calendar[d].first;
+			while (e != nil) {
+				handle n = events[e].next;
+				if (dead(e)) {
+					rem(e);
+					events[e].gen++;
+					events.free(e);
+					tombs--;
+				}
+				e = n;
+			}
+		}
+	}
+
+	// Move up to n non-empty days of the old calendar into the new one.
+	// Tombstones are released rather than moved.
+	void migrate(uint64_t n) {
+		for (; n > 0 and not old.empty(); n--) {
+			uint64_t d = old.size();
+			if (cursor < old.size()) {
+				uint64_t from = (first+cursor)&(old.size()-1);
+				uint64_t to = from < first ? first : old.size();
+				d = old_occupied.find(from, to);
+				if (d >= to) {
+					d = from >= first ? old_occupied.find(0, first) : first;
+					d = d >= first ? old.size() : d;
+				}
+			}
+			if (d >= old.size()) {
+				old.clear();
+				break;
+			}
+
+			handle e = old[d].first;
+			old[d].first = nil;
+			old[d].second = nil;
+			old_occupied.unmark(d);
+			cursor = ((d-first)&(old.size()-1))+1;
+			while (e != nil) {
+				handle n = events[e].next;
+				events[e].next = nil;
+				events[e].prev = nil;
+				count--;
+				if (dead(e)) {
+					events[e].gen++;
+					events.free(e);
+					tombs--;
+				} else {
+					add(e, true);
+				}
+				e = n;
+			}
+		}
+		if (cursor >= old.size()) {
+			old.clear();
+		}
+	}
+
+	// complete any incremental resize in progress
+	void finish() {
+		migrate(std::numeric_limits<uint64_t>::max());
+	}
+
+	// Change the calendar to days of 2^to over a year of 2^span, either all
+	// at once or incrementally as configured by the resize policy
+	void resize(int to, int span) {
+		finish();
+		if (to == day and span == year) {
+			return;
+		} else if (span-to > year-day) {
+			grows++;
+		} else if (span-to < year-day) {
+			shrinks++;
+		}
+
+		if (policy.migrate == 0 and span == year) {
+			while (day > to) {
+				grow();
+			}
+			while (day < to) {
+				shrink();
+			}
+			return;
+		}
+
+		old.swap(calendar);
+		std::swap(old_occupied, occupied);
+		old_day = day;
+		old_year = year;
+		first = olddayof(now);
+		cursor = 0;
+
+		day = to;
+		year = span;
+		calendar.assign(days(), std::pair<handle, handle>(nil, nil));
+		occupied.resize(days());
+		migrate(policy.migrate == 0 ? std::numeric_limits<uint64_t>::max() : policy.migrate);
+	}
+
+	void resize(int to) {
+		resize(to, year);
+	}
+
+	// The day shift that best fits the sampled gaps, or -1 if too few gaps
+	// have been sampled. Gaps more than twice the mean are left out so that
+	// a few idle periods do not widen the days.
+	int fit() {
+		uint64_t n = std::min<uint64_t>(sampled, gaps.size());
+		if (n < 16) {
+			return -1;
+		}
+
+		double mean = 0.0;
+		for (uint64_t i = 0; i < n; i++) {
+			mean += (double)gaps[i];
+		}
+		mean /= (double)n;
+
+		double sum = 0.0;
+		uint64_t m = 0;
+		for (uint64_t i = 0; i < n; i++) {
+			if ((double)gaps[i] <= 2.0*mean) {
+				sum += (double)gaps[i];
+				m++;
+			}
+		}
+
+		double width = 3.0*sum/(double)m;
+		int to = 0;
+		while (to < 63 and (double)(1ul<<to) < width) {
+			to++;
+		}
+		return to;
+	}
+
+	// Pick the day width from the sampled gaps and enough days to hold the
+	// current events, and move the calendar there. Returns false if there
+	// are not enough samples to pick a width.
+	bool retune() {
+		int to = fit();
+		if (to < 0) {
+			return false;
+		}
+
+		uint64_t n = size();
+		int lg = std::max(mindiff, n > 1 ? (int)std::bit_width(n-1) : 0);
+		to = std::min(to, 63-lg);
+		if (to != day) {
+			retunes++;
+		}
+		resize(to, to+lg);
+		return true;
+	}
+
+	// Called when the calendar holds too many or too few events for its
+	// number of days. to is the day shift a fixed width policy would move to.
+	void rebalance(int to) {
+		if (policy.adapt and retune()) {
+			return;
+		}
+		if (to >= 0 and year-to >= mindiff) {
+			resize(to);
+		}
+	}
+
+	// Record the gap between two events popped from the head, and retune if
+	// the sampled gaps have drifted well away from the current day width.
+	void sample(uint64_t t) {
+		if (last != std::numeric_limits<uint64_t>::max() and t >= last) {
+			gaps[sampled%gaps.size()] = t-last;
+			sampled++;
+			if (sampled%gaps.size() == 0) {
+				int to = fit();
+				if (to > day+1 or to < day-1) {
+					retune();
+				}
+			}
+		}
+		last = t;
+	}
+
 	void shrink() {
+		compact();
 		for (int i = 0; i < (int)calendar.size(); i+=2) {
 			// merge calendar[i] and calendar[i+1]
-			if (calendar[i].second == nullptr) {
+			if (calendar[i].second == nil) {
 				calendar[i] = calendar[i+1];
-			} else if (calendar[i+1].first != nullptr) {
-				event *e0 = calendar[i].second;
-				event *e1 = calendar[i+1].second;
-				uint64_t y0 = e0 == nullptr ? yearof(now) : yearof(priority(e0->value));
-				uint64_t y1 = e1 == nullptr ? yearof(now) : yearof(priority(e1->value));
-				uint64_t sy0 = calendar[i].first == nullptr ? yearof(now) : yearof(priority(calendar[i].first->value));
-				uint64_t sy1 = calendar[i].first == nullptr ? yearof(now) : yearof(priority(calendar[i+1].first->value));
-				while (e1 != nullptr) {
+			} else if (calendar[i+1].first != nil) {
+				handle e0 = calendar[i].second;
+				handle e1 = calendar[i+1].second;
+				uint64_t y0 = e0 == nil ? yearof(now) : yearof(priority(events[e0].value));
+				uint64_t y1 = e1 == nil ? yearof(now) : yearof(priority(events[e1].value));
+				uint64_t sy0 = calendar[i].first == nil ? yearof(now) : yearof(priority(events[calendar[i].first].value));
+				uint64_t sy1 = calendar[i].first == nil ? yearof(now) : yearof(priority(events[calendar[i+1].first].value));
+				while (e1 != nil) {
 					if (y0 <= y1) {
-						event *s1 = nullptr;
-						if (y1 != sy1 and e0 != nullptr) {
+						handle s1 = nil;
+						if (y1 != sy1 and e0 != nil) {
 							// if most events are in the same year, then we don't need to do
 							// this search most of the time.
-							// if e0 is nullptr, then we can move the entire list over
-							for (s1 = e1->prev; s1 != nullptr and yearof(priority(s1->value)) == y1; s1 = s1->prev);
+							// if e0 is nil, then we can move the entire list over
+							for (s1 = events[e1].prev; s1 != nil and yearof(priority(events[s1].value)) == y1; s1 = events[s1].prev);
 						}
-						// by definition, e1 will not be nullptr because there would be
+						// by definition, e1 will not be nil because there would be
 						// nothing to move over
 						
-						if (s1 == nullptr) {
-							calendar[i+1].first->prev = e0;
-						} /*else if (s1->next == nullptr) {
+						if (s1 == nil) {
+							events[calendar[i+1].first].prev = e0;
+						} /*else if (events[s1].next == nil) {
 							// this shouldn't happen by definition of s1
-						}*/ else if (s1->next != nullptr) {
-							s1->next->prev = e0;
+						}*/ else if (events[s1].next != nil) {
+							events[events[s1].next].prev = e0;
 						}
 
-						event *n = calendar[i].first;
-						if (e0 == nullptr) {
-							calendar[i].first->prev = e1;
-						} else if (e0->next == nullptr) {
+						handle n = calendar[i].first;
+						if (e0 == nil) {
+							events[calendar[i].first].prev = e1;
+						} else if (events[e0].next == nil) {
 							calendar[i].second = e1;
 						} else {
-							e0->next->prev = e1;
+							events[events[e0].next].prev = e1;
 						}
 
-						/*if (e1->next == nullptr) {
+						/*if (events[e1].next == nil) {
 							// already end of list, nothing needs to happen here
-						} else */ if (e1->next != nullptr) {
-							e1->next->prev = nullptr;
+						} else */ if (events[e1].next != nil) {
+							events[events[e1].next].prev = nil;
 						}
 
-						if (e0 == nullptr) {
-							e1->next = n;
-							calendar[i].first = (s1 == nullptr ? calendar[i+1].first : s1->next);
+						if (e0 == nil) {
+							events[e1].next = n;
+							calendar[i].first = (s1 == nil ? calendar[i+1].first : events[s1].next);
 						} else {
-							e1->next = e0->next;
-							e0->next = (s1 == nullptr ? calendar[i+1].first : s1->next);
+							events[e1].next = events[e0].next;
+							events[e0].next = (s1 == nil ? calendar[i+1].first : events[s1].next);
 						}
 
-						if (s1 != nullptr) {
-							s1->next = nullptr;
+						if (s1 != nil) {
+							events[s1].next = nil;
 						}
 
 						e1 = s1;
-						if (e1 != nullptr) {
-							y1 = yearof(priority(e1->value));
+						if (e1 != nil) {
+							y1 = yearof(priority(events[e1].value));
 						}
 					} else if (y0 != sy0) {
-						if (e0 != nullptr) {
-							e0 = e0->prev;
+						if (e0 != nil) {
+							e0 = events[e0].prev;
 						}
-						while (e0 != nullptr and yearof(priority(e0->value)) == y0) {
-							e0 = e0->prev;
+						while (e0 != nil and yearof(priority(events[e0].value)) == y0) {
+							e0 = events[e0].prev;
 						}
-						if (e0 != nullptr) {
-							y0 = yearof(priority(e0->value));
+						if (e0 != nil) {
+							y0 = yearof(priority(events[e0].value));
 						} else {
 							y0 = yearof(now); // Reset to avoid comparisons with uninitialized value
 							sy0 = y0;
 						}
 					} else {
-						e0 = nullptr;
+						e0 = nil;
 						y0 = yearof(now);
 						sy0 = y0;
 					}
 				}
 			}
-			calendar[i+1].first = nullptr;
-			calendar[i+1].second = nullptr;
+			calendar[i+1].first = nil;
+			calendar[i+1].second = nil;
 
 			if (i != 0) {
 				calendar[i/2] = calendar[i];
@@ -210,274 +766,411 @@ struct calendar_queue {
 		}
 		day++;
 		calendar.erase(calendar.begin()+days(), calendar.end());
+		reindex();
 	}
 
 	void grow() {
+		compact();
 		day--;
-		calendar.resize(days(), std::pair<event*, event*>(nullptr, nullptr));
+		calendar.resize(days(), std::pair<handle, handle>(nil, nil));
 		for (int i = (int)calendar.size()-1; i >= 0; i--) {
-			if (calendar[i].first == nullptr) {
+			if (calendar[i].first == nil) {
 				continue;
 			}
 			if (i != 0) {
 				calendar[i*2] = calendar[i];
 			}
 
-			event *e = calendar[i*2].second;
-			uint64_t y0 = yearof(priority(calendar[i*2].first->value));
-			uint64_t t = priority(e->value);
+			handle e = calendar[i*2].second;
+			uint64_t y0 = yearof(priority(events[calendar[i*2].first].value));
+			uint64_t t = priority(events[e].value);
 			uint64_t y = yearof(t);
 			uint64_t d = dayof(t);
-			while (e != nullptr and (y > y0 or (int)d != i*2)) {
-				while (e != nullptr and (int)d == i*2) {
-					e = e->prev;
-					if (e != nullptr) {
-						t = priority(e->value);
+			while (e != nil and (y > y0 or (int)d != i*2)) {
+				while (e != nil and (int)d == i*2) {
+					e = events[e].prev;
+					if (e != nil) {
+						t = priority(events[e].value);
 						y = yearof(t);
 						d = dayof(t);
 						if (y == y0 and (int)d == i*2) {
-							e = nullptr;
+							e = nil;
 						}
 					}
 				}
-				if (e == nullptr) {
+				if (e == nil) {
 					break;
 				}
 
-				event *s = e;
-				while (s != nullptr and dayof(priority(s->value)) == d) {
-					s = s->prev;
+				handle s = e;
+				while (s != nil and dayof(priority(events[s].value)) == d) {
+					s = events[s].prev;
 				}
 
-				if (e->next == nullptr) {
+				if (events[e].next == nil) {
 					calendar[i*2].second = s;
 				} else {
-					e->next->prev = s;
+					events[events[e].next].prev = s;
 				}
-				/*if (s == nullptr) {
-					// Then calendar[i*2].first->prev is already nullptr
-				} else*/ if (s != nullptr) {
-					s->next->prev = nullptr;
+				/*if (s == nil) {
+					// Then events[calendar[i*2].first].prev is already nil
+				} else*/ if (s != nil) {
+					events[events[s].next].prev = nil;
 				}
 
-				event *n = e->next;
-				e->next = calendar[i*2+1].first;
+				handle n = events[e].next;
+				events[e].next = calendar[i*2+1].first;
 				
-				if (s == nullptr) {
+				if (s == nil) {
 					calendar[i*2+1].first = calendar[i*2].first;
 				} else {
-					calendar[i*2+1].first = s->next;
+					calendar[i*2+1].first = events[s].next;
 				}
 
-				if (e->next == nullptr) {
+				if (events[e].next == nil) {
 					calendar[i*2+1].second = e;
 				} else {
-					e->next->prev = e;
+					events[events[e].next].prev = e;
 				}
 
-				if (s == nullptr) {
+				if (s == nil) {
 					calendar[i*2].first = n;
 				} else {
-					s->next = n;
+					events[s].next = n;
 				}
 
 				e = s;
-				if (e != nullptr) {
-					t = priority(e->value);
+				if (e != nil) {
+					t = priority(events[e].value);
 					y = yearof(t);
 					d = dayof(t);
 				}
 			}
 
 			if (i != 0) {
-				calendar[i].first = nullptr;
-				calendar[i].second = nullptr;
+				calendar[i].first = nil;
+				calendar[i].second = nil;
 			}
 		}
+		reindex();
 	}
 
-	event *next(uint64_t time=std::numeric_limits<uint64_t>::max()) {
-		if (empty()) {
-			return nullptr;
-		}
-		if (time == std::numeric_limits<uint64_t>::max()) {
-			time = now;
-		}
-
-		auto start = calendar.begin()+dayof(time);
-		uint64_t y = yearof(time);
-		event *m = nullptr;
-		uint64_t mt = std::numeric_limits<uint64_t>::max();
-		for (auto di = start; di != calendar.end(); di++) {
-			for (event *e = di->first; e != nullptr; e = e->next) {
-				uint64_t et = priority(e->value);
-				if (et >= time) {
-					if (yearof(et) == y) {
-						if (time == now) {
-							now = et;
-						}
-						return e;
-					}
-
-					if (et < mt) {
+	// Find the earliest live event at or after time in one calendar, where
+	// shift and span are that calendar's day and year shifts. m and mt are
+	// replaced if it is earlier than mt. The search stops at the first day
+	// that starts after an event already found in m.
+	void search(days_t &cal, O &index, int shift, int span, uint64_t time, handle &m, uint64_t &mt) {
+		uint64_t start = (time>>shift)&((1ul<<(span-shift))-1ul);
+		uint64_t end = cal.size();
+		uint64_t y = time>>span;
+		for (uint64_t d = index.find(start, end); d < end; d = index.find(d+1, end)) {
+			if (m != nil and ((y<<span)|(d<<shift)) > mt) {
+				return;
+			}
+			for (handle e = cal[d].first; e != nil; e = events[e].next) {
+				uint64_t et = priority(events[e].value);
+				if (et >= time and not dead(e)) {
+					if (m == nil or et < mt) {
 						m = e;
 						mt = et;
 					}
+					if ((et>>span) == y) {
+						return;
+					}
 					break;
 				}
 			}
 		}
 		y++;
 
-		for (auto di = calendar.begin(); di != start; di++) {
-			for (event *e = di->first; e != nullptr; e = e->next) {
-				uint64_t et = priority(e->value);
-				if (et >= time) {
-					if (yearof(et) == y) {
-						if (time == now) {
-							now = et;
-						}
-						return e;
-					}
-
-					if (et < mt) {
+		for (uint64_t d = index.find(0, start); d < start; d = index.find(d+1, start)) {
+			if (m != nil and ((y<<span)|(d<<shift)) > mt) {
+				return;
+			}
+			for (handle e = cal[d].first; e != nil; e = events[e].next) {
+				uint64_t et = priority(events[e].value);
+				if (et >= time and not dead(e)) {
+					if (m == nil or et < mt) {
 						m = e;
 						mt = et;
 					}
+					if ((et>>span) == y) {
+						return;
+					}
 					break;
 				}
 			}
 		}
-		
+	}
+
+	handle next(uint64_t time=std::numeric_limits<uint64_t>::max()) {
+		if (empty()) {
+			return nil;
+		}
+		if (time == std::numeric_limits<uint64_t>::max()) {
+			time = now;
+		}
+
+		// Migration starts from the days closest to now, so those are in the
+		// new calendar and the old one only holds later days. The old calendar
+		// is still searched first so that whatever it finds bounds mt, which
+		// ends the search of the new calendar at the first day past mt.
+		handle m = nil;
+		uint64_t mt = std::numeric_limits<uint64_t>::max();
+		if (not old.empty()) {
+			search(old, old_occupied, old_day, old_year, time, m, mt);
+		}
+		search(calendar, occupied, day, year, time, m, mt);
+
 		if (time == now) {
 			now = mt;
 		}
 		return m;
 	}
 
-	void add(event *e) {
-		uint64_t t = priority(e->value);
-		uint64_t d = dayof(t);
-
-		event *n = calendar[d].first;
-		while (n != nullptr and priority(n->value) < t) {
-			n = n->next;
-		}
-
-		if (n == nullptr) {
-			if (calendar[d].second == nullptr) {
-				calendar[d].first = e;
-				calendar[d].second = e;
+	// link e into day d of cal immediately before n, or at the end of the day
+	// if n is nil
+	void link(days_t &cal, O &index, uint64_t d, handle e, handle n) {
+		if (n == nil) {
+			if (cal[d].second == nil) {
+				cal[d].first = e;
+				cal[d].second = e;
+				index.mark(d);
 			} else {
-				calendar[d].second->next = e;
-				e->prev = calendar[d].second;
-				calendar[d].second = e;
+				events[cal[d].second].next = e;
+				events[e].prev = cal[d].second;
+				cal[d].second = e;
 			}
 		} else {
-			e->prev = n->prev;
-			e->next = n;
-			if (n->prev == nullptr) {
-				calendar[d].first = e;
+			events[e].prev = events[n].prev;
+			events[e].next = n;
+			if (events[n].prev == nil) {
+				cal[d].first = e;
 			} else {
-				n->prev->next = e;
+				events[events[n].prev].next = e;
+			}
+			events[n].prev = e;
+		}
+	}
+
+	// Whether the queued event n stays ahead of a new event with time t and
+	// tie k. The new event goes before any events with the same time and tie,
+	// or after them if fifo is set.
+	bool ahead(handle n, uint64_t t, uint64_t k, bool fifo) {
+		uint64_t nt = priority(events[n].value);
+		if (nt != t) {
+			return nt < t;
+		}
+		uint64_t nk = priority_tie(priority, events[n].value);
+		return nk < k or (fifo and nk == k);
+	}
+
+	// Link e into its day, in order of time and then tie
+	void add(handle e, bool fifo=false) {
+		uint64_t t = priority(events[e].value);
+		uint64_t k = priority_tie(priority, events[e].value);
+		bool o = unmigrated(t);
+		days_t &cal = o ? old : calendar;
+		O &index = o ? old_occupied : occupied;
+		uint64_t d = o ? olddayof(t) : dayof(t);
+
+		// events usually arrive later than everything already in their day
+		handle n = nil;
+		handle last = cal[d].second;
+		if (last != nil and not ahead(last, t, k, fifo)) {
+			n = cal[d].first;
+			while (n != nil and ahead(n, t, k, fifo)) {
+				n = events[n].next;
 			}
-			n->prev = e;
 		}
+
+		link(cal, index, d, e, n);
 		if (t < now) {
 			now = t;
 		}
 		count++;
 	}
 
-	event *rem(event *e) {
-		if (e == nullptr) {
-			return nullptr;
+	handle rem(handle e) {
+		if (e == nil) {
+			return nil;
 		}
 
-		uint64_t d = dayof(priority(e->value));
-		if (e->prev == nullptr) {
-			calendar[d].first = e->next;
+		uint64_t t = priority(events[e].value);
+		bool o = unmigrated(t);
+		days_t &cal = o ? old : calendar;
+		O &index = o ? old_occupied : occupied;
+		uint64_t d = o ? olddayof(t) : dayof(t);
+		if (events[e].prev == nil) {
+			cal[d].first = events[e].next;
 		} else {
-			e->prev->next = e->next;
+			events[events[e].prev].next = events[e].next;
 		}
 
-		if (e->next == nullptr) {
-			calendar[d].second = e->prev;
+		if (events[e].next == nil) {
+			cal[d].second = events[e].prev;
 		} else {
-			e->next->prev = e->prev;
+			events[events[e].next].prev = events[e].prev;
+		}
+		if (cal[d].first == nil) {
+			index.unmark(d);
 		}
-		e->next = nullptr;
-		e->prev = nullptr;
+		events[e].next = nil;
+		events[e].prev = nil;
 		count--;
 		return e;
 	}
 
-	void set(event *e, T value) {
-		if (priority(value) < priority(e->value)) {
-			e->value = value;
+	void set(handle e, T value) {
+		if (priority(value) < priority(events[e].value)) {
+			events[e].value = value;
 			add(rem(e));
 		}
 	}
 
-	event *push(T value) {
-		event *result = nullptr;
-		if (unused != nullptr) {
-			result = unused;
-			unused = unused->next;
-			if (unused != nullptr) {
-				unused->prev = nullptr;
-			}
-			result->next = nullptr;
-		} else {
-			events.push_back(event(events.size()));
-			result = &events.back();
-		}
+	event &operator[](handle e) {
+		return events[e];
+	}
 
-		result->value = value;
+	handle push(T value) {
+		handle result = events.alloc();
+		events[result].value = value;
 		add(result);
-		if (day > 0 and count > (days()<<1)) {
-			grow();
+		migrate(policy.migrate);
+		if (count > (days()<<policy.grow)) {
+			rebalance(day-1);
 		}
 		return result;
 	}
 
-	T pop(event *e) {
+	// Push every value in [first, last) into the queue. The new events are
+	// sorted by day and time once, then merged into each affected day in a
+	// single pass, and the calendar is resized at most once at the end. The
+	// events are placed exactly as pushing them one at a time would place
+	// them, so among events with the same time and tie the later ones come
+	// out first. The handles are returned in input order.
+	template <typename I>
+	std::vector<handle> push_batch(I first, I last) {
+		std::vector<handle> result;
+		push_batch(first, last, result);
+		return result;
+	}
+
+	// As above, but the handles are written into result, whose storage is
+	// reused along with the queue's own sort buffer, so a caller that keeps
+	// result across batches pushes them without allocating
+	template <typename I>
+	void push_batch(I first, I last, std::vector<handle> &result) {
+		finish();
+
+		result.clear();
+		batch_order.clear();
+		for (I i = first; i != last; i++) {
+			handle e = events.alloc();
+			events[e].value = *i;
+			uint64_t t = priority(events[e].value);
+			batch_order.push_back(batch_entry{t, dayof(t), priority_tie(priority, events[e].value), batch_order.size(), e});
+			result.push_back(e);
+		}
+
+		// Equal keys are sorted by descending input order, which matches
+		// add() without the temporary buffer of std::stable_sort
+		std::sort(batch_order.begin(), batch_order.end(), [](const batch_entry &a, const batch_entry &b) {
+			if (a.day != b.day) {
+				return a.day < b.day;
+			} else if (a.time != b.time) {
+				return a.time < b.time;
+			} else if (a.tie != b.tie) {
+				return a.tie < b.tie;
+			}
+			return a.index > b.index;
+		});
+
+		for (auto i = batch_order.begin(); i != batch_order.end(); ) {
+			uint64_t d = i->day;
+			handle n = calendar[d].first;
+			for (; i != batch_order.end() and i->day == d; i++) {
+				while (n != nil and ahead(n, i->time, i->tie, false)) {
+					n = events[n].next;
+				}
+				link(calendar, occupied, d, i->e, n);
+				if (i->time < now) {
+					now = i->time;
+				}
+			}
+		}
+		count += batch_order.size();
+
+		if (count > (days()<<policy.grow)) {
+			rebalance(day-1);
+		}
+	}
+
+	T pop(handle e) {
 		e = rem(e);
-		if (e == nullptr) {
+		if (e == nil) {
 			return T();
 		}
-		e->next = unused;
-		e->prev = nullptr;
-		if (unused != nullptr) {
-			unused->prev = e;
+		if (dead(e)) {
+			events[e].gen++;
+			tombs--;
+		} else {
+			events[e].gen += 2;
+		}
+		events.free(e);
+		migrate(policy.migrate);
+		if (year-day > mindiff and size() < (days()>>policy.shrink)) {
+			rebalance(day+1);
+		}
+		return events[e].value;
+	}
+
+	// Lazily remove an event. It stays linked into its day as a tombstone
+	// until the next compaction.
+	void cancel(handle e) {
+		if (e == nil or dead(e)) {
+			return;
 		}
-		unused = e;
-		if (year-day > mindiff and count < (days()>>1)) {
-			shrink();
+		events[e].gen++;
+		tombs++;
+		if (tombs > (count>>1)) {
+			compact();
 		}
-		return e->value;
 	}
 
 	T pop(uint64_t time=std::numeric_limits<uint64_t>::max()) {
-		return pop(next(time));
+		handle e = next(time);
+		if (policy.adapt and e != nil and time == std::numeric_limits<uint64_t>::max()) {
+			sample(priority(events[e].value));
+		}
+		return pop(e);
 	}
 
 	uint64_t size() {
-		return count;
+		return count-tombs;
 	}
 
 	bool empty() {
-		return count == 0;
+		return count == tombs;
 	}
 
 	void clear() {
 		events.clear();
-		unused = nullptr;
 		calendar.clear();
-		day = year-mindiff;
-		calendar.resize(days());
+		old.clear();
+		cursor = 0;
+		// an adaptive queue keeps the day width it has learned
+		if (policy.adapt) {
+			year = day+mindiff;
+		} else {
+			day = year-mindiff;
+		}
+		last = std::numeric_limits<uint64_t>::max();
+		calendar.resize(days(), std::pair<handle, handle>(nil, nil));
+		occupied.resize(days());
 		now = 0;
 		count = 0;
+		tombs = 0;
 	}
 };
 
@@ -0,0 +1,95 @@
+#include "counters.h"
+
+#include <algorithm>
+
+namespace prs {
+
+sim_counters::sim_counters() {
+	clear();
+}
+
+sim_counters::~sim_counters() {
+}
+
+void sim_counters::clear() {
+	scheduled = 0;
+	fired = 0;
+	cancelled = 0;
+	vacuous = 0;
+	interfering = 0;
+	evaluations = 0;
+	worklist_total = 0;
+	worklist_max = 0;
+	grows = 0;
+	shrinks = 0;
+	retunes = 0;
+	net_scheduled.clear();
+	net_fired.clear();
+	net_evaluated.clear();
+	dev_modeled.clear();
+}
+
+static uint64_t countAt(const vector<uint64_t> &counts, int i) {
+	return i < (int)counts.size() ? counts[i] : 0;
+}
+
+// Indices of the nonzero counts, largest first, at most top of them
+static vector<int> hottest(const vector<uint64_t> &counts, int top) {
+	vector<int> result;
+	for (int i = 0; i < (int)counts.size(); i++) {
+		if (counts[i] > 0) {
+			result.push_back(i);
+		}
+	}
+	stable_sort(result.begin(), result.end(), [&](int a, int b) {
+		return counts[a] > counts[b];
+	});
+	if ((int)result.size() > top) {
+		result.resize(top);
+	}
+	return result;
+}
+
+static string device_name(const production_rule_set *base, int i) {
+	const device &dev = base->devs[i];
+	return base->netAt(dev.source) + "&" + (dev.threshold == 0 ? "~" : "") + base->netAt(dev.gate) + "->" + base->netAt(dev.drain) + (dev.driver == 0 ? "-" : "+");
+}
+
+string sim_counters::to_string(const production_rule_set *base, int top) const {
+	string result;
+	result += "scheduled " + std::to_string(scheduled) + "\n";
+	result += "fired " + std::to_string(fired) + "\n";
+	result += "cancelled " + std::to_string(cancelled) + "\n";
+	result += "vacuous " + std::to_string(vacuous) + "\n";
+	result += "interfering " + std::to_string(interfering) + "\n";
+	result += "evaluations " + std::to_string(evaluations) + " worklist mean " + std::to_string(evaluations == 0 ? 0.0 : (double)worklist_total/(double)evaluations) + " max " + std::to_string(worklist_max) + "\n";
+	result += "queue grows " + std::to_string(grows) + " shrinks " + std::to_string(shrinks) + " retunes " + std::to_string(retunes) + "\n";
+
+	result += "hottest nets:\n";
+	for (int i : hottest(net_evaluated, top)) {
+		result += "\t" + base->netAt(i) + " evaluated " + std::to_string(net_evaluated[i]) + " scheduled " + std::to_string(countAt(net_scheduled, i)) + " fired " + std::to_string(countAt(net_fired, i)) + "\n";
+	}
+	result += "hottest devices:\n";
+	for (int i : hottest(dev_modeled, top)) {
+		result += "\t" + device_name(base, i) + " modeled " + std::to_string(dev_modeled[i]) + "\n";
+	}
+	return result;
+}
+
+string sim_counters::nets_to_string(const production_rule_set *base) const {
+	string result;
+	for (int i = 0; i < (int)base->nets.size(); i++) {
+		result += base->netAt(i) + " " + std::to_string(countAt(net_scheduled, i)) + " " + std::to_string(countAt(net_fired, i)) + " " + std::to_string(countAt(net_evaluated, i)) + "\n";
+	}
+	return result;
+}
+
+string sim_counters::devs_to_string(const production_rule_set *base) const {
+	string result;
+	for (int i = 0; i < (int)base->devs.size(); i++) {
+		result += device_name(base, i) + " " + std::to_string(countAt(dev_modeled, i)) + "\n";
+	}
+	return result;
+}
+
+}
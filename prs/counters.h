@@ -0,0 +1,65 @@
+#pragma once
+
+#include "production_rule.h"
+#include <common/standard.h>
+
+// The simulator only updates its counters when the library is built with
+// PRS_COUNTERS defined, which `make COUNTERS=1` does. Otherwise every
+// PRS_COUNT() statement compiles away and the counters stay at zero.
+#ifdef PRS_COUNTERS
+#define PRS_COUNT(x) do { x; } while (0)
+#else
+#define PRS_COUNT(x) do { } while (0)
+#endif
+
+namespace prs {
+
+// What the simulator spent its time on, in total and per net or device, to
+// find the parts of a circuit that make it slow to simulate
+struct sim_counters {
+	sim_counters();
+	~sim_counters();
+
+	uint64_t scheduled;    // calls to schedule()
+	uint64_t fired;        // events fired
+	uint64_t cancelled;    // pending events cancelled by assume()
+	uint64_t vacuous;      // scheduled events that replaced a vacuous one
+	uint64_t interfering;  // scheduled events merged into a pending one
+
+	// Calls to evaluate() that had nets waiting, and the total and largest
+	// number of nets waiting at the start of each
+	uint64_t evaluations;
+	uint64_t worklist_total;
+	uint64_t worklist_max;
+
+	// Copied from a calendar queue backend after each event
+	uint64_t grows;
+	uint64_t shrinks;
+	uint64_t retunes;
+
+	// Indexed by net: events scheduled, events fired, and times evaluated
+	vector<uint64_t> net_scheduled;
+	vector<uint64_t> net_fired;
+	vector<uint64_t> net_evaluated;
+	// Indexed by device: calls to model()
+	vector<uint64_t> dev_modeled;
+
+	static void bump(vector<uint64_t> &counts, int i) {
+		if (i >= (int)counts.size()) {
+			counts.resize(i+1, 0);
+		}
+		counts[i]++;
+	}
+
+	void clear();
+
+	// The totals, followed by the top nets by evaluations and the top devices
+	// by calls to model()
+	string to_string(const production_rule_set *base, int top=10) const;
+	// One line per net with its scheduled, fired, and evaluated counts
+	string nets_to_string(const production_rule_set *base) const;
+	// One line per device with its gate, drain, and calls to model()
+	string devs_to_string(const production_rule_set *base) const;
+};
+
+}
@@ -0,0 +1,97 @@
+#include "delay_model.h"
+
+#include <math.h>
+
+namespace prs {
+
+static inline uint64_t rotl(uint64_t x, int k) {
+	return (x << k) | (x >> (64 - k));
+}
+
+xoshiro256::xoshiro256() {
+	seed(0);
+}
+
+xoshiro256::xoshiro256(uint64_t seed) {
+	this->seed(seed);
+}
+
+xoshiro256::~xoshiro256() {
+}
+
+void xoshiro256::seed(uint64_t seed) {
+	for (int i = 0; i < 4; i++) {
+		seed += 0x9e3779b97f4a7c15ull;
+		uint64_t z = seed;
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+		s[i] = z ^ (z >> 31);
+	}
+}
+
+uint64_t xoshiro256::next() {
+	uint64_t result = rotl(s[1] * 5, 7) * 9;
+	uint64_t t = s[1] << 17;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotl(s[3], 45);
+	return result;
+}
+
+// The top 53 bits fill the mantissa of a double exactly
+double xoshiro256::uniform() {
+	return (double)(next() >> 11) * 0x1.0p-53;
+}
+
+delay_model::delay_model() {
+	policy = pareto;
+	shape = 5.0;
+	min_ratio = 0.5;
+	seed = 0;
+	rng.seed(seed);
+}
+
+delay_model::delay_model(int policy, uint64_t seed) {
+	this->policy = policy;
+	this->shape = 5.0;
+	this->min_ratio = 0.5;
+	this->seed = seed;
+	rng.seed(seed);
+}
+
+delay_model::~delay_model() {
+}
+
+void delay_model::reseed() {
+	rng.seed(seed);
+}
+
+void delay_model::reseed(uint64_t seed) {
+	this->seed = seed;
+	rng.seed(seed);
+}
+
+uint64_t delay_model::draw(uint64_t delay_max) {
+	switch (policy) {
+	case pareto: {
+		// Inverse transform, with 1-u in (0, 1] so the power is finite
+		double u = 1.0 - rng.uniform();
+		return (uint64_t)((double)delay_max / pow(u, 1.0/shape));
+	}
+	case uniform: {
+		uint64_t lo = (uint64_t)((double)delay_max*min_ratio);
+		if (lo >= delay_max) {
+			return delay_max;
+		}
+		return lo + rng.next() % (delay_max - lo + 1);
+	}
+	case fixed_min:
+		return (uint64_t)((double)delay_max*min_ratio);
+	}
+	return delay_max;
+}
+
+}
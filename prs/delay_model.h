@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace prs {
+
+// xoshiro256** by Blackman and Vigna. Small, fast, and seedable, so every
+// simulator can own one and parallel runs neither contend on nor perturb
+// each other's random streams.
+struct xoshiro256 {
+	xoshiro256();
+	xoshiro256(uint64_t seed);
+	~xoshiro256();
+
+	uint64_t s[4];
+
+	// Expand seed into the four words of state with splitmix64, which never
+	// leaves them all zero
+	void seed(uint64_t seed);
+	uint64_t next();
+	// Uniform in [0, 1)
+	double uniform();
+};
+
+// Chooses the delay of each transition from its delay_max. Each simulator
+// owns one, seeded independently, so a run is reproducible from its seed.
+struct delay_model {
+	enum {
+		// Pareto distributed with scale delay_max and the given shape, most
+		// transitions near delay_max with a long tail
+		pareto = 0,
+		// Uniform between min_ratio*delay_max and delay_max
+		uniform = 1,
+		// Always delay_max
+		fixed_max = 2,
+		// Always min_ratio*delay_max
+		fixed_min = 3
+	};
+
+	delay_model();
+	delay_model(int policy, uint64_t seed=0);
+	~delay_model();
+
+	int policy;
+	double shape;
+	double min_ratio;
+
+	// The stream restarts from seed on reseed()
+	uint64_t seed;
+	xoshiro256 rng;
+
+	void reseed();
+	void reseed(uint64_t seed);
+
+	// The fixed policies skip the generator and the transcendental math
+	// entirely
+	uint64_t sample(uint64_t delay_max) {
+		if (policy == fixed_max) {
+			return delay_max;
+		}
+		return draw(delay_max);
+	}
+
+	uint64_t draw(uint64_t delay_max);
+};
+
+}
@@ -0,0 +1,189 @@
+#include "flat_netlist.h"
+
+#include <algorithm>
+
+namespace prs
+{
+
+flat_netlist::flat_netlist() {
+	offset.push_back(0);
+}
+
+flat_netlist::flat_netlist(const production_rule_set &prs) {
+	devs.reserve(prs.devs.size());
+	assume.reserve(prs.devs.size());
+	for (auto d = prs.devs.begin(); d != prs.devs.end(); d++) {
+		flat_device f;
+		f.source = d->source;
+		f.gate = d->gate;
+		f.drain = d->drain;
+		f.threshold = (int8_t)d->threshold;
+		f.driver = (int8_t)d->driver;
+		f.weak = d->attr.weak;
+		f.force = d->attr.force;
+		f.assumes = not d->attr.assume.is_tautology();
+		f.delay_max = d->attr.delay_max;
+		devs.push_back(f);
+
+		assume.push_back(vector<sparse_cube>());
+		if (f.assumes) {
+			for (auto c = d->attr.assume.cubes.begin(); c != d->attr.assume.cubes.end(); c++) {
+				assume.back().push_back(sparse_cube(*c));
+			}
+		}
+	}
+
+	// Each net's remote list is its whole remote group, computed once here
+	// so that the simulator never has to call remote_groups()
+	vector<vector<int> > groups = prs.remote_groups();
+	vector<int> group(prs.nets.size(), -1);
+	for (int g = 0; g < (int)groups.size(); g++) {
+		for (int n : groups[g]) {
+			group[n] = g;
+		}
+	}
+
+	size_t total = 0;
+	for (int n = 0; n < (int)prs.nets.size(); n++) {
+		for (int i = 0; i < 2; i++) {
+			total += prs.nets[n].gateOf[i].size() + prs.nets[n].sourceOf[i].size() + prs.nets[n].drainOf[i].size();
+		}
+		total += groups[group[n]].size();
+	}
+
+	nets.reserve(prs.nets.size());
+	offset.reserve(prs.nets.size()*LISTS+1);
+	edges.reserve(total);
+	for (auto n = prs.nets.begin(); n != prs.nets.end(); n++) {
+		const vector<int> &remote = groups[group[n - prs.nets.begin()]];
+
+		flat_net f;
+		f.keep = n->keep;
+		f.node = n->isNode();
+		f.gated = not n->gateOf[0].empty() or not n->gateOf[1].empty();
+		f.sourced = not n->sourceOf[0].empty() or not n->sourceOf[1].empty();
+		f.driver = (int8_t)n->driver;
+		nets.push_back(f);
+
+		const vector<int> *lists[LISTS] = {
+			&n->gateOf[0], &n->gateOf[1],
+			&n->sourceOf[0], &n->sourceOf[1],
+			&n->drainOf[0], &n->drainOf[1],
+			&remote
+		};
+		for (int k = 0; k < LISTS; k++) {
+			offset.push_back((int)edges.size());
+			edges.insert(edges.end(), lists[k]->begin(), lists[k]->end());
+		}
+	}
+	offset.push_back((int)edges.size());
+}
+
+flat_netlist::~flat_netlist() {
+}
+
+int flat_netlist::size() const {
+	return (int)nets.size();
+}
+
+bool flat_netlist::matches(const production_rule_set &prs) const {
+	if (devs.size() != prs.devs.size() or nets.size() != prs.nets.size()) {
+		return false;
+	}
+
+	for (int i = 0; i < (int)devs.size(); i++) {
+		const flat_device &f = devs[i];
+		const device &d = prs.devs[i];
+		if (f.source != d.source or f.gate != d.gate or f.drain != d.drain
+			or f.threshold != d.threshold or f.driver != d.driver
+			or f.weak != d.attr.weak or f.force != d.attr.force
+			or f.delay_max != d.attr.delay_max
+			or f.assumes == d.attr.assume.is_tautology()) {
+			return false;
+		}
+
+		if (f.assumes) {
+			if (assume[i].size() != d.attr.assume.cubes.size()) {
+				return false;
+			}
+			for (int c = 0; c < (int)assume[i].size(); c++) {
+				const sparse_cube &s = assume[i][c];
+				int count = 0;
+				bool same = true;
+				for_each_literal(d.attr.assume.cubes[c], [&](int var, int val) {
+					count++;
+					same = same and s.get(var) == val;
+				});
+				if (not same or count != s.size()) {
+					return false;
+				}
+			}
+		}
+	}
+
+	for (int n = 0; n < (int)nets.size(); n++) {
+		const flat_net &f = nets[n];
+		const net &p = prs.nets[n];
+		if (f.keep != p.keep or f.node != p.isNode() or f.driver != p.driver) {
+			return false;
+		}
+
+		const vector<int> *lists[REMOTE] = {
+			&p.gateOf[0], &p.gateOf[1],
+			&p.sourceOf[0], &p.sourceOf[1],
+			&p.drainOf[0], &p.drainOf[1]
+		};
+		for (int k = 0; k < REMOTE; k++) {
+			span<const int> l = list(n, k);
+			if (not std::equal(l.begin(), l.end(), lists[k]->begin(), lists[k]->end())) {
+				return false;
+			}
+		}
+
+		// A new remote connection joins two groups
+		span<const int> group = remote(n);
+		for (int r : p.remote) {
+			if (r >= 0 and r < size() and not std::binary_search(group.begin(), group.end(), r)) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// This is a reverse postorder of a depth first search over the fanout of
+// each net. The gate and source lists of a net are adjacent in edges, so the
+// search walks them as a single range.
+vector<int> flat_netlist::levelize() const {
+	vector<int> order;
+	order.reserve(nets.size());
+	vector<bool> seen(nets.size(), false);
+
+	// net and the next edge of its fanout to visit
+	vector<pair<int, int> > stack;
+	for (int root = 0; root < size(); root++) {
+		if (seen[root]) {
+			continue;
+		}
+		seen[root] = true;
+		stack.push_back(pair<int, int>(root, offset[root*LISTS+GATE]));
+		while (not stack.empty()) {
+			int net = stack.back().first;
+			int &e = stack.back().second;
+			if (e < offset[net*LISTS+SOURCE+2]) {
+				int drain = devs[edges[e++]].drain;
+				if (not seen[drain]) {
+					seen[drain] = true;
+					stack.push_back(pair<int, int>(drain, offset[drain*LISTS+GATE]));
+				}
+			} else {
+				order.push_back(net);
+				stack.pop_back();
+			}
+		}
+	}
+	reverse(order.begin(), order.end());
+	return order;
+}
+
+}
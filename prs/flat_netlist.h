@@ -0,0 +1,116 @@
+#pragma once
+
+#include "production_rule.h"
+#include "sparse_cube.h"
+#include <common/standard.h>
+
+#include <vector>
+#include <span>
+#include <stdint.h>
+
+using namespace std;
+
+namespace prs
+{
+
+// The fields of a device that the simulator reads on every evaluation,
+// packed together. The remaining attributes stay in the production rule set,
+// except for the assumption, which is compiled into flat_netlist::assume.
+struct flat_device {
+	int source;
+	int gate;
+	int drain;
+	int8_t threshold;  // Gate value that turns the transistor on
+	int8_t driver;     // Value driven when on
+	bool weak;
+	bool force;
+	bool assumes;      // attr.assume is not a tautology
+	uint64_t delay_max;
+};
+
+// The per-net flags the simulator reads on every evaluation
+struct flat_net {
+	bool keep;
+	bool node;     // unnamed internal node, see net::isNode()
+	bool gated;    // gate of at least one device
+	bool sourced;  // source of at least one device
+	int8_t driver; // constant driver value, -1 if not a power net
+};
+
+// A read-only, compiled view of a production_rule_set for the simulator's
+// inner loops. Each net in production_rule_set carries its name and seven
+// separately allocated adjacency vectors, so walking the devices on a net
+// pulls a cold string and several heap blocks through the cache. Here the
+// adjacency lists of every net are concatenated into one array in
+// compressed sparse row form, with net n's lists in the order gateOf[0],
+// gateOf[1], sourceOf[0], sourceOf[1], drainOf[0], drainOf[1], remote, and
+// offset marking where each list begins.
+//
+// The view is a copy, so it has to be rebuilt after the production rule set
+// is modified. matches() checks whether that is needed.
+struct flat_netlist {
+	flat_netlist();
+	flat_netlist(const production_rule_set &prs);
+	~flat_netlist();
+
+	enum {
+		GATE = 0,
+		SOURCE = 2,
+		DRAIN = 4,
+		REMOTE = 6,
+		LISTS = 7
+	};
+
+	vector<flat_device> devs;
+	vector<flat_net> nets;
+
+	// The cubes of each device's assumption as sparse cubes, so that the
+	// simulator checks them against its state without dense copies. Empty
+	// for devices without an assumption.
+	vector<vector<sparse_cube> > assume;
+
+	// list k of net n is edges[offset[n*LISTS+k]] to edges[offset[n*LISTS+k+1]]
+	vector<int> offset;
+	vector<int> edges;
+
+	// These are defined here so that they inline into the simulator's loops
+	span<const int> list(int net, int k) const {
+		int i = net*LISTS+k;
+		return span<const int>(edges.data()+offset[i], edges.data()+offset[i+1]);
+	}
+
+	// devices whose gate is net, by threshold
+	span<const int> gateOf(int net, int threshold) const {
+		return list(net, GATE+threshold);
+	}
+
+	// devices whose source is net, by driver
+	span<const int> sourceOf(int net, int driver) const {
+		return list(net, SOURCE+driver);
+	}
+
+	// devices whose drain is net, by driver
+	span<const int> drainOf(int net, int driver) const {
+		return list(net, DRAIN+driver);
+	}
+
+	// the remote group of net, the nets connected to it across region
+	// boundaries including net itself, in increasing order
+	span<const int> remote(int net) const {
+		return list(net, REMOTE);
+	}
+
+	int size() const;
+
+	// Whether this view is still up to date with prs. Every compiled field
+	// and list is compared in place, which is much cheaper than rebuilding
+	// the view and does not allocate. A remote connection removed from prs
+	// is not detected.
+	bool matches(const production_rule_set &prs) const;
+
+	// Order the nets so that each comes before the nets it drives through
+	// the gate or source of a device, breaking feedback loops arbitrarily
+	vector<int> levelize() const;
+};
+
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+// An unbounded single producer, single consumer queue that needs no locks.
+// Values are written into fixed size blocks that form a linked list. The
+// producer fills the block at the tail and publishes each value by storing
+// the new count with release ordering, and links a fresh block once the tail
+// is full. The consumer reads up to the published count with acquire
+// ordering, and frees a block once it has read all of it and the next block
+// is linked. Neither side ever waits on the other, so a producer may keep
+// sending while its consumer is busy or blocked elsewhere.
+template <typename T, int N=256>
+struct mailbox {
+	struct block {
+		block() {
+			count.store(0, std::memory_order_relaxed);
+			next.store(nullptr, std::memory_order_relaxed);
+		}
+
+		T values[N];
+		std::atomic<int> count;
+		std::atomic<block*> next;
+	};
+
+	block *head; // read by the consumer
+	int read;
+	block *tail; // written by the producer
+
+	mailbox() {
+		head = new block();
+		tail = head;
+		read = 0;
+	}
+
+	mailbox(const mailbox &m) = delete;
+	mailbox &operator=(const mailbox &m) = delete;
+
+	~mailbox() {
+		while (head != nullptr) {
+			block *next = head->next.load(std::memory_order_relaxed);
+			delete head;
+			head = next;
+		}
+	}
+
+	// Called by the producer only
+	void push(const T &value) {
+		int n = tail->count.load(std::memory_order_relaxed);
+		if (n == N) {
+			block *b = new block();
+			b->values[0] = value;
+			b->count.store(1, std::memory_order_relaxed);
+			tail->next.store(b, std::memory_order_release);
+			tail = b;
+			return;
+		}
+		tail->values[n] = value;
+		tail->count.store(n+1, std::memory_order_release);
+	}
+
+	// Called by the consumer only. Returns false if there is nothing to read.
+	bool pop(T &value) {
+		if (read == N) {
+			block *next = head->next.load(std::memory_order_acquire);
+			if (next == nullptr) {
+				return false;
+			}
+			delete head;
+			head = next;
+			read = 0;
+		}
+		if (read >= head->count.load(std::memory_order_acquire)) {
+			return false;
+		}
+		value = head->values[read++];
+		return true;
+	}
+};
@@ -0,0 +1,387 @@
+#include "model_checker.h"
+
+#include <algorithm>
+#include <climits>
+#include <iterator>
+#include <set>
+#include <thread>
+
+namespace prs {
+
+// Finalizer of splitmix64
+static uint64_t mix(uint64_t h) {
+	h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+	return h ^ (h >> 31);
+}
+
+state_set::state_set() {
+	bits = 0;
+	count = 0;
+}
+
+state_set::state_set(int bits) {
+	this->bits = bits;
+	slots = vector<std::atomic<uint64_t> >((size_t)1 << bits);
+	levels = vector<std::atomic<int> >((size_t)1 << bits);
+	clear();
+}
+
+state_set::~state_set() {
+}
+
+bool state_set::insert(uint64_t h, int level, int *found) {
+	h = h == 0 ? 1 : h;
+	uint64_t mask = slots.size()-1;
+	for (uint64_t i = h & mask, n = 0; n < slots.size(); i = (i+1) & mask, n++) {
+		uint64_t prev = slots[i].load(std::memory_order_relaxed);
+		if (prev == 0 and slots[i].compare_exchange_strong(prev, h)) {
+			levels[i].store(level, std::memory_order_release);
+			count++;
+			return true;
+		} else if (prev == h) {
+			if (found != nullptr) {
+				*found = levels[i].load(std::memory_order_acquire);
+			}
+			return false;
+		}
+	}
+	return false;
+}
+
+bool state_set::full() const {
+	return count >= slots.size()/4*3;
+}
+
+void state_set::clear() {
+	for (auto s = slots.begin(); s != slots.end(); s++) {
+		*s = 0;
+	}
+	for (auto l = levels.begin(); l != levels.end(); l++) {
+		*l = INT_MAX;
+	}
+	count = 0;
+}
+
+check_error::check_error() {
+	kind = interference;
+	net = -1;
+}
+
+check_error::check_error(int kind, int net, vector<pair<int, int> > trace) {
+	this->kind = kind;
+	this->net = net;
+	this->trace = trace;
+}
+
+check_error::~check_error() {
+}
+
+string check_error::to_string(const production_rule_set *base) const {
+	string result;
+	switch (kind) {
+	case interference: result = "interference " + base->netAt(net); break;
+	case instability: result = "unstable rule " + base->netAt(net); break;
+	case deadlock: result = "deadlock"; break;
+	}
+
+	result += " after";
+	for (auto t = trace.begin(); t != trace.end(); t++) {
+		result += " " + base->netAt(t->first) + (t->second == 1 ? "+" : (t->second == 0 ? "-" : "~"));
+	}
+	return result;
+}
+
+check_node::check_node() {
+	parent = -1;
+	net = -1;
+	value = 2;
+}
+
+check_node::check_node(int parent, int net, int value) {
+	this->parent = parent;
+	this->net = net;
+	this->value = value;
+}
+
+check_node::~check_node() {
+}
+
+model_checker::model_checker() {
+	base = NULL;
+	reduce = true;
+	deadlock = true;
+	transitions = 0;
+	complete = true;
+}
+
+model_checker::model_checker(const production_rule_set *base, int bits) : visited(bits) {
+	this->base = base;
+	reduce = true;
+	deadlock = true;
+	transitions = 0;
+	complete = true;
+
+	flat_netlist flat(*base);
+	auto power = [&](int net) {
+		return flat.nets[net].driver >= 0;
+	};
+
+	reads.resize(flat.size());
+	readers.resize(flat.size());
+	for (int n = 0; n < flat.size(); n++) {
+		if (power(n)) {
+			continue;
+		}
+
+		// walk back through the stacks of internal nodes that drive n
+		vector<int> stack(1, n);
+		vector<bool> seen(flat.size(), false);
+		seen[n] = true;
+		while (not stack.empty()) {
+			int x = stack.back();
+			stack.pop_back();
+			for (int driver = 0; driver < 2; driver++) {
+				for (int i : flat.drainOf(x, driver)) {
+					const flat_device &dev = flat.devs[i];
+					if (not power(dev.gate)) {
+						reads[n].push_back(dev.gate);
+					}
+					if (not power(dev.source)) {
+						reads[n].push_back(dev.source);
+						if (flat.nets[dev.source].node and not seen[dev.source]) {
+							seen[dev.source] = true;
+							stack.push_back(dev.source);
+						}
+					}
+					for (auto c = flat.assume[i].begin(); c != flat.assume[i].end(); c++) {
+						for (auto l = c->begin(); l != c->end(); l++) {
+							reads[n].push_back(l->var);
+						}
+					}
+				}
+			}
+		}
+
+		for (int r : flat.remote(n)) {
+			if (r != n) {
+				reads[n].push_back(r);
+			}
+		}
+
+		sort(reads[n].begin(), reads[n].end());
+		reads[n].erase(unique(reads[n].begin(), reads[n].end()), reads[n].end());
+		for (int r : reads[n]) {
+			if (r < flat.size()) {
+				readers[r].push_back(n);
+			}
+		}
+	}
+}
+
+model_checker::~model_checker() {
+}
+
+uint64_t model_checker::hash(simulator &sim) const {
+	uint64_t h = 0;
+	const boolean::cube *cubes[3] = {&sim.encoding, &sim.global, &sim.strength};
+	for (int c = 0; c < 3; c++) {
+		for (auto w = cubes[c]->values.begin(); w != cubes[c]->values.end(); w++) {
+			h = mix(h ^ *w);
+		}
+		h = mix(h ^ cubes[c]->values.size());
+	}
+
+	for (int net = 0; net < (int)sim.nets.size(); net++) {
+		if (sim.nets[net] != simulator::queue::nil) {
+			const enabled_event &e = sim.enabled[sim.nets[net]].value;
+			h = mix(h ^ ((uint64_t)net << 16) ^ ((uint64_t)(uint8_t)e.value << 8) ^ ((uint64_t)(uint8_t)e.strength << 1) ^ (uint64_t)e.stable);
+		}
+	}
+	return h;
+}
+
+// Try each enabled transition as the seed of the closure, and keep the
+// smallest set found
+vector<int> model_checker::stubborn(simulator &sim, const vector<int> &enabled) const {
+	vector<bool> pending(std::max(sim.nets.size(), reads.size()), false);
+	for (int net : enabled) {
+		pending[net] = true;
+	}
+
+	vector<int> best = enabled;
+	for (auto seed = enabled.begin(); seed != enabled.end() and best.size() > 1; seed++) {
+		vector<int> result;
+		vector<bool> seen(pending.size(), false);
+		vector<int> stack(1, *seed);
+		seen[*seed] = true;
+		auto visit = [&](int net) {
+			if (net < (int)seen.size() and not seen[net]) {
+				seen[net] = true;
+				stack.push_back(net);
+			}
+		};
+
+		while (not stack.empty() and result.size() < best.size()) {
+			int x = stack.back();
+			stack.pop_back();
+			if (x < (int)reads.size()) {
+				for (int r : reads[x]) {
+					visit(r);
+				}
+			}
+			if (not pending[x]) {
+				continue;
+			}
+
+			result.push_back(x);
+			if (x < (int)readers.size()) {
+				for (int r : readers[x]) {
+					visit(r);
+				}
+			}
+			const enabled_terms &terms = sim.terms[x];
+			for (auto l = terms.guard.begin(); l != terms.guard.end(); l++) {
+				visit(l->var);
+			}
+			for (auto l = terms.assume.begin(); l != terms.assume.end(); l++) {
+				visit(l->var);
+			}
+		}
+
+		if (stack.empty() and result.size() < best.size()) {
+			best = result;
+		}
+	}
+	return best;
+}
+
+vector<pair<int, int> > model_checker::trace(int node) const {
+	vector<pair<int, int> > result;
+	for (int i = node; i >= 0 and nodes[i].parent >= 0; i = nodes[i].parent) {
+		result.push_back(pair<int, int>(nodes[i].net, nodes[i].value));
+	}
+	reverse(result.begin(), result.end());
+	return result;
+}
+
+void model_checker::check(simulator &sim, int threads) {
+	threads = std::max(threads, 1);
+	visited.clear();
+	nodes.clear();
+	errors.clear();
+	transitions = 0;
+	complete = true;
+
+	// Each error is reported once per kind and net, with the shortest trace
+	std::set<pair<int, int> > reported;
+
+	nodes.push_back(check_node());
+	vector<pair<int, simulator_state> > frontier;
+	frontier.push_back(pair<int, simulator_state>(0, sim.snapshot()));
+	visited.insert(hash(sim));
+
+	vector<simulator> sims(threads, sim);
+	for (auto s = sims.begin(); s != sims.end(); s++) {
+		s->tracer = nullptr;
+		s->checker = nullptr;
+	}
+	for (int level = 0; not frontier.empty(); level++) {
+		// The states each thread reached, their parents, and the errors it
+		// found. Nodes are numbered once the level is done.
+		vector<vector<pair<int, simulator_state> > > next(threads);
+		vector<vector<check_node> > found(threads);
+		vector<vector<check_error> > failed(threads);
+
+		std::atomic<int> cursor(0);
+		auto work = [&](int w) {
+			simulator &s = sims[w];
+			for (int i = cursor++; i < (int)frontier.size(); i = cursor++) {
+				const simulator_state &state = frontier[i].second;
+				int node = frontier[i].first;
+				s.restore(state);
+
+				vector<int> enabled;
+				for (int net = 0; net < (int)s.nets.size(); net++) {
+					if (s.nets[net] != simulator::queue::nil) {
+						enabled.push_back(net);
+					}
+				}
+				if (enabled.empty()) {
+					if (deadlock) {
+						failed[w].push_back(check_error(check_error::deadlock, -1, trace(node)));
+					}
+					continue;
+				}
+
+				vector<int> fire = reduce ? stubborn(s, enabled) : enabled;
+				sort(fire.begin(), fire.end());
+				bool all = fire.size() == enabled.size();
+				while (true) {
+					bool revisit = false;
+					for (int net : fire) {
+						s.restore(state);
+						enabled_transition t = s.fire(net);
+						transitions++;
+
+						if (not t.stable or t.value == -1) {
+							vector<pair<int, int> > path = trace(node);
+							path.push_back(pair<int, int>(net, t.value));
+							failed[w].push_back(check_error(t.stable ? check_error::interference : check_error::instability, net, path));
+						}
+
+						int prev = INT_MAX;
+						if (visited.full()) {
+							continue;
+						} else if (visited.insert(hash(s), level+1, &prev)) {
+							found[w].push_back(check_node(node, net, t.value));
+							next[w].push_back(pair<int, simulator_state>((int)found[w].size()-1, s.snapshot()));
+						} else if (prev <= level) {
+							revisit = true;
+						}
+					}
+
+					if (all or not revisit) {
+						break;
+					}
+
+					// The cycle proviso: fire the rest of the enabled transitions too
+					vector<int> rest;
+					set_difference(enabled.begin(), enabled.end(), fire.begin(), fire.end(), back_inserter(rest));
+					fire = rest;
+					all = true;
+				}
+			}
+		};
+
+		vector<std::thread> pool;
+		for (int w = 1; w < threads; w++) {
+			pool.push_back(std::thread(work, w));
+		}
+		work(0);
+		for (auto t = pool.begin(); t != pool.end(); t++) {
+			t->join();
+		}
+
+		frontier.clear();
+		for (int w = 0; w < threads; w++) {
+			int offset = (int)nodes.size();
+			nodes.insert(nodes.end(), found[w].begin(), found[w].end());
+			for (auto n = next[w].begin(); n != next[w].end(); n++) {
+				frontier.push_back(pair<int, simulator_state>(n->first + offset, std::move(n->second)));
+			}
+			for (auto e = failed[w].begin(); e != failed[w].end(); e++) {
+				if (reported.insert(pair<int, int>(e->kind, e->net)).second) {
+					errors.push_back(*e);
+				}
+			}
+		}
+
+		if (visited.full()) {
+			complete = false;
+			break;
+		}
+	}
+}
+
+}
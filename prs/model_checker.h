@@ -0,0 +1,134 @@
+#pragma once
+
+#include "production_rule.h"
+#include "simulator.h"
+#include <common/standard.h>
+
+#include <atomic>
+#include <vector>
+
+namespace prs {
+
+// A set of 64 bit state fingerprints that many threads insert into at once
+// without locks. The fingerprints live in one open addressed table with
+// linear probing, where 0 marks an empty slot. Only the fingerprint of each
+// state is stored, so two states with the same fingerprint are treated as
+// one. With 64 bits that is unlikely for as many states as the table holds.
+// Each slot also keeps the level of the search at which its state was found.
+struct state_set {
+	state_set();
+	state_set(int bits);
+	~state_set();
+
+	int bits;
+	vector<std::atomic<uint64_t> > slots;
+	vector<std::atomic<int> > levels;
+	std::atomic<uint64_t> count;
+
+	// Returns true if h was not yet in the set, and records it at level.
+	// Otherwise, if found is not null, it is set to the level h was recorded
+	// at, or INT_MAX if another thread is still recording it.
+	bool insert(uint64_t h, int level=0, int *found=nullptr);
+	// At most three quarters of the slots are used, to keep probes short
+	bool full() const;
+	void clear();
+};
+
+// A problem reached by model_checker, and the transitions that reach it
+struct check_error {
+	enum {
+		interference = 0, // a stable transition to -1
+		instability = 1,  // an unstable transition
+		deadlock = 2      // a state with no enabled transitions
+	};
+
+	check_error();
+	check_error(int kind, int net, vector<pair<int, int> > trace);
+	~check_error();
+
+	int kind;
+	int net;  // -1 for a deadlock
+
+	// The net and value of each transition fired from the initial state,
+	// ending with the offending one
+	vector<pair<int, int> > trace;
+
+	string to_string(const production_rule_set *base) const;
+};
+
+// A state reached by model_checker, identified by its index in nodes, and
+// the transition that first reached it
+struct check_node {
+	check_node();
+	check_node(int parent, int net, int value);
+	~check_node();
+
+	int parent;
+	int net;
+	int value;
+};
+
+// Explores every order in which the enabled transitions of a simulator can
+// fire, ignoring their delays, and reports the interference, instability,
+// and deadlock it reaches. Each state is a simulator_state, so firing a
+// transition from a state only copies the chunks it changes, and visited
+// states are identified by a fingerprint of encoding, global, strength, and
+// the pending transitions.
+//
+// The states are searched breadth first, one level at a time, so the trace
+// of each error is as short as possible. The states of a level are shared
+// out between threads, each with its own copy of the simulator, and the
+// states they reach are numbered once all threads finish the level.
+//
+// With reduce set, only a stubborn set of the enabled transitions is fired
+// from each state. Firing a transition writes its net and the nets of its
+// guard, and may change the transitions pending on the nets that read it,
+// so two transitions are dependent if either reads or writes what the other
+// writes. The stubborn set is closed under dependence for enabled
+// transitions, and for disabled ones under the nets that could enable them,
+// so no transition outside of it can affect one inside of it. A state that
+// reaches a state from its own level or an earlier one fires all of its
+// transitions, so that a transition is never put off around a cycle. Every
+// cycle has such an edge, while a state first found in the next level
+// cannot close one. Which thread finds a state of the next level first
+// does not matter, so the states and transitions counted do not depend on
+// the number of threads.
+struct model_checker {
+	model_checker();
+	model_checker(const production_rule_set *base, int bits=22);
+	~model_checker();
+
+	const production_rule_set *base;
+
+	// Fire only a stubborn set of the enabled transitions in each state
+	bool reduce;
+	// Report states in which nothing is enabled
+	bool deadlock;
+
+	// Nets read when evaluating the drivers of each net, through the gates
+	// and sources of its devices, the stacks of internal nodes behind them,
+	// their assumptions, and its remote copies, and the nets that read
+	// each net. Power nets never change and are left out.
+	vector<vector<int> > reads;
+	vector<vector<int> > readers;
+
+	state_set visited;
+	vector<check_node> nodes;
+	vector<check_error> errors;
+	// Transitions fired
+	std::atomic<uint64_t> transitions;
+	// False if visited filled up before every state was explored
+	bool complete;
+
+	// Explore every state reachable from the current state of sim
+	void check(simulator &sim, int threads=1);
+
+	uint64_t hash(simulator &sim) const;
+	// The enabled transitions to fire from the current state of sim, a
+	// stubborn set if reduce is set
+	vector<int> stubborn(simulator &sim, const vector<int> &enabled) const;
+	// The transitions that reach a node from the initial state
+	vector<pair<int, int> > trace(int node) const;
+};
+
+}
@@ -0,0 +1,219 @@
+#include "monte_carlo.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace prs {
+
+histogram::histogram() {
+	lo = 0;
+	width = 1;
+	clear();
+}
+
+histogram::histogram(uint64_t lo, uint64_t width, int bins) {
+	this->lo = lo;
+	this->width = width == 0 ? 1 : width;
+	this->bins.assign(bins, 0);
+	clear();
+}
+
+histogram::~histogram() {
+}
+
+void histogram::add(uint64_t value) {
+	if (value < lo) {
+		under++;
+	} else if ((value - lo)/width >= bins.size()) {
+		over++;
+	} else {
+		bins[(value - lo)/width]++;
+	}
+	count++;
+	sum += (double)value;
+	min = std::min(min, value);
+	max = std::max(max, value);
+}
+
+void histogram::merge(const histogram &h) {
+	for (int i = 0; i < (int)bins.size() and i < (int)h.bins.size(); i++) {
+		bins[i] += h.bins[i];
+	}
+	under += h.under;
+	over += h.over;
+	count += h.count;
+	sum += h.sum;
+	min = std::min(min, h.min);
+	max = std::max(max, h.max);
+}
+
+void histogram::clear() {
+	bins.assign(bins.size(), 0);
+	under = 0;
+	over = 0;
+	count = 0;
+	sum = 0.0;
+	min = std::numeric_limits<uint64_t>::max();
+	max = 0;
+}
+
+double histogram::mean() const {
+	return count == 0 ? 0.0 : sum/(double)count;
+}
+
+stimulus_step::stimulus_step() {
+	at = 0;
+	net = -1;
+	value = 2;
+}
+
+stimulus_step::stimulus_step(uint64_t at, int net, int value) {
+	this->at = at;
+	this->net = net;
+	this->value = value;
+}
+
+stimulus_step::~stimulus_step() {
+}
+
+sweep_run::sweep_run() {
+	seed = 0;
+	events = 0;
+	changes = 0;
+	unstable = 0;
+	interference = 0;
+	period = 0.0;
+}
+
+sweep_run::~sweep_run() {
+}
+
+monte_carlo::monte_carlo() {
+	base = NULL;
+	until = 0;
+	period = histogram(0, 100, 256);
+	unstable = histogram(0, 1, 64);
+	interference = histogram(0, 1, 64);
+}
+
+monte_carlo::monte_carlo(const production_rule_set *base) {
+	this->base = base;
+	until = 0;
+	period = histogram(0, 100, 256);
+	unstable = histogram(0, 1, 64);
+	interference = histogram(0, 1, 64);
+}
+
+monte_carlo::~monte_carlo() {
+}
+
+sweep_run monte_carlo::run(simulator &sim, uint64_t seed, histogram &period, histogram &unstable, histogram &interference) {
+	sweep_run result;
+	result.seed = seed;
+
+	sim.delay = delay;
+	sim.delay.reseed(seed);
+	sim.reset();
+
+	// time of the last change of each probe
+	vector<uint64_t> last(probes.size(), std::numeric_limits<uint64_t>::max());
+	uint64_t gaps = 0;
+	double total = 0.0;
+
+	uint64_t start = sim.now;
+	auto step = stimulus.begin();
+	while (true) {
+		uint64_t t = std::numeric_limits<uint64_t>::max();
+		if (not sim.enabled.empty()) {
+			t = sim.enabled[sim.enabled.next()].value.fire_at;
+		}
+		if (step != stimulus.end() and start + step->at <= t and step->at <= until) {
+			sim.now = std::max(sim.now, start + step->at);
+			sim.set(step->net, step->value);
+			step++;
+			continue;
+		} else if (t == std::numeric_limits<uint64_t>::max() or t > start + until) {
+			break;
+		}
+
+		int net = sim.enabled[sim.enabled.next()].value.net;
+		int prev = sim.encoding.get(net);
+		enabled_transition e = sim.fire();
+		result.events++;
+		if (not e.stable) {
+			result.unstable++;
+		}
+		if (e.value == -1) {
+			result.interference++;
+		}
+
+		int value = sim.encoding.get(net);
+		if (value == prev) {
+			continue;
+		}
+		for (int p = 0; p < (int)probes.size(); p++) {
+			if (probes[p].first == net and probes[p].second == value) {
+				if (last[p] != std::numeric_limits<uint64_t>::max()) {
+					period.add(e.fire_at - last[p]);
+					total += (double)(e.fire_at - last[p]);
+					gaps++;
+				}
+				last[p] = e.fire_at;
+				result.changes++;
+			}
+		}
+	}
+
+	if (gaps > 0) {
+		result.period = total/(double)gaps;
+	}
+	unstable.add(result.unstable);
+	interference.add(result.interference);
+	return result;
+}
+
+void monte_carlo::sweep(int count, int threads, uint64_t seed) {
+	threads = std::max(1, std::min(threads, count));
+	runs.assign(count, sweep_run());
+	period.clear();
+	unstable.clear();
+	interference.clear();
+
+	// Each thread takes the next run from a shared counter and writes only
+	// its own slot of runs and its own histograms
+	std::atomic<int> next(0);
+	vector<histogram> hist(3*threads);
+	for (int i = 0; i < threads; i++) {
+		hist[3*i + 0] = period;
+		hist[3*i + 1] = unstable;
+		hist[3*i + 2] = interference;
+	}
+
+	// The netlist is compiled once and shared by every thread's simulator
+	std::shared_ptr<const flat_netlist> flat = std::make_shared<const flat_netlist>(*base);
+
+	auto work = [&](int w) {
+		simulator sim(base, flat);
+		for (int r = next++; r < count; r = next++) {
+			runs[r] = run(sim, seed + r, hist[3*w + 0], hist[3*w + 1], hist[3*w + 2]);
+		}
+	};
+
+	vector<std::thread> pool;
+	for (int w = 1; w < threads; w++) {
+		pool.push_back(std::thread(work, w));
+	}
+	work(0);
+	for (auto t = pool.begin(); t != pool.end(); t++) {
+		t->join();
+	}
+
+	for (int w = 0; w < threads; w++) {
+		period.merge(hist[3*w + 0]);
+		unstable.merge(hist[3*w + 1]);
+		interference.merge(hist[3*w + 2]);
+	}
+}
+
+}
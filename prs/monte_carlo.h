@@ -0,0 +1,104 @@
+#pragma once
+
+#include "production_rule.h"
+#include "simulator.h"
+#include <common/standard.h>
+
+#include <limits>
+
+namespace prs {
+
+// Counts of values in bins of equal width starting at lo, with the values
+// that fall below or above the bins counted separately. Two histograms with
+// the same bins merge by adding their counts.
+struct histogram {
+	histogram();
+	histogram(uint64_t lo, uint64_t width, int bins);
+	~histogram();
+
+	uint64_t lo;
+	uint64_t width;
+	vector<uint64_t> bins;
+	uint64_t under;
+	uint64_t over;
+
+	uint64_t count;
+	double sum;
+	uint64_t min;
+	uint64_t max;
+
+	void add(uint64_t value);
+	void merge(const histogram &h);
+	void clear();
+	double mean() const;
+};
+
+// A change applied by the stimulus at a time after reset
+struct stimulus_step {
+	stimulus_step();
+	stimulus_step(uint64_t at, int net, int value);
+	~stimulus_step();
+
+	uint64_t at;
+	int net;
+	int value;
+};
+
+// What one run of the sweep observed
+struct sweep_run {
+	sweep_run();
+	~sweep_run();
+
+	uint64_t seed;
+	uint64_t events;        // transitions fired
+	uint64_t changes;       // transitions of a probe net to its probe value
+	uint64_t unstable;      // transitions fired as unstable
+	uint64_t interference;  // transitions fired to -1
+	double period;          // mean time between consecutive changes of a probe, 0 if none
+};
+
+// Reruns the same circuit with a different random seed per run to
+// characterize its timing, spreading the runs across threads. Every run
+// resets its simulator, reseeds its delay model with seed+run, applies the
+// stimulus at the given times after reset, and fires events up to until
+// after reset. The production rule set and the flat_netlist compiled from
+// it are shared read-only between the threads, and each thread reuses one
+// simulator for all of its runs, so memory stays near one netlist plus the
+// state of one simulator per thread.
+//
+// Each probe is a transition of a net to a value, and the time between two
+// consecutive changes of that net to that value is recorded in period, which
+// measures cycle time when the probe sits on a ring. The per-run counts of
+// unstable and interfering transitions are recorded in unstable and
+// interference. Threads fill their own histograms and merge them at the end,
+// and each run's result depends only on its seed, so a sweep is
+// reproducible for any number of threads.
+struct monte_carlo {
+	monte_carlo();
+	monte_carlo(const production_rule_set *base);
+	~monte_carlo();
+
+	const production_rule_set *base;
+
+	// Delay policy for every run. Its seed is replaced by seed+run.
+	delay_model delay;
+
+	// Sorted by time
+	vector<stimulus_step> stimulus;
+	vector<pair<int, int> > probes;
+	uint64_t until;
+
+	vector<sweep_run> runs;
+	histogram period;
+	histogram unstable;
+	histogram interference;
+
+	// Run count runs over the given number of threads, replacing the
+	// results of any earlier sweep
+	void sweep(int count, int threads, uint64_t seed=0);
+
+	// Run one run on sim, recording into the given histograms
+	sweep_run run(simulator &sim, uint64_t seed, histogram &period, histogram &unstable, histogram &interference);
+};
+
+}
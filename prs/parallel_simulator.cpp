@@ -0,0 +1,283 @@
+#include "parallel_simulator.h"
+
+namespace prs {
+
+// Pick a where m is set and b elsewhere, lane by lane
+template <int N>
+static inline lanes<N> select(const lanes<N> &m, const lanes<N> &a, const lanes<N> &b) {
+	return (a & m) | (b & ~m);
+}
+
+// Lanes where a drives strictly stronger than b
+template <int N>
+static inline lanes<N> stronger(const lanes<N> &a1, const lanes<N> &a2, const lanes<N> &a3, const lane_state<N> &b) {
+	return (a1 & ~b.s1) | (a2 & ~b.s2) | (a3 & ~b.s3);
+}
+
+// Fold one driver into the resolved value and strength of a net in the
+// lanes of m, the same way simulator::model() does for a single lane: a
+// stronger driver takes over, and drivers of equal strength are combined
+// with a bitwise and so that conflicting values produce X.
+template <int N>
+static inline void resolve(lane_state<N> &r, const lanes<N> &m, const lanes<N> &lo, const lanes<N> &hi, const lanes<N> &s1, const lanes<N> &s2, const lanes<N> &s3) {
+	lanes<N> take = m & stronger(s1, s2, s3, r);
+	lanes<N> same = m & ~((s1 ^ r.s1) | (s2 ^ r.s2) | (s3 ^ r.s3));
+	r.lo = select(take, lo, select(same, r.lo & lo, r.lo));
+	r.hi = select(take, hi, select(same, r.hi & hi, r.hi));
+	r.s1 = select(take, s1, r.s1);
+	r.s2 = select(take, s2, r.s2);
+	r.s3 = select(take, s3, r.s3);
+}
+
+template <int N>
+basic_parallel_simulator<N>::basic_parallel_simulator() {
+	base = NULL;
+}
+
+template <int N>
+basic_parallel_simulator<N>::basic_parallel_simulator(const production_rule_set *base) {
+	this->base = base;
+	if (base != NULL) {
+		flat = flat_netlist(*base);
+	}
+}
+
+template <int N>
+basic_parallel_simulator<N>::~basic_parallel_simulator() {
+}
+
+// This over-approximates propagate() in simulator: every device the net
+// could affect is queued, and evaluate() sorts out which are on.
+template <int N>
+void basic_parallel_simulator<N>::fanout(int net) {
+	for (int k = 0; k < 2; k++) {
+		for (int i : flat.gateOf(net, k)) {
+			pending.push(flat.devs[i].drain);
+		}
+		for (int i : flat.sourceOf(net, k)) {
+			pending.push(flat.devs[i].drain);
+		}
+	}
+}
+
+template <int N>
+void basic_parallel_simulator<N>::set(int net, const word &mask, int value, int strength) {
+	state s;
+	s.lo = (value == 0 or value == 2) ? word::ones() : word::zeros();
+	s.hi = (value == 1 or value == 2) ? word::ones() : word::zeros();
+	s.s1 = strength >= 1 ? word::ones() : word::zeros();
+	s.s2 = strength >= 2 ? word::ones() : word::zeros();
+	s.s3 = strength >= 3 ? word::ones() : word::zeros();
+
+	for (int r : flat.remote(net)) {
+		state &t = nets[r];
+		t.lo = select(mask, s.lo, t.lo);
+		t.hi = select(mask, s.hi, t.hi);
+		t.s1 = select(mask, s.s1, t.s1);
+		t.s2 = select(mask, s.s2, t.s2);
+		t.s3 = select(mask, s.s3, t.s3);
+		fanout(r);
+	}
+}
+
+template <int N>
+void basic_parallel_simulator<N>::set(int net, int lane, int value, int strength) {
+	set(net, word::bit(lane), value, strength);
+}
+
+template <int N>
+int basic_parallel_simulator<N>::get(int net, int lane) const {
+	return ((int)nets[net].lo.get(lane) | ((int)nets[net].hi.get(lane)<<1)) - 1;
+}
+
+template <int N>
+int basic_parallel_simulator<N>::strength(int net, int lane) const {
+	return (int)nets[net].s1.get(lane) + (int)nets[net].s2.get(lane) + (int)nets[net].s3.get(lane);
+}
+
+// This is simulator::evaluate() and simulator::model() for every lane at
+// once. Each device contributes to the drive in the lanes where its gate is
+// at its threshold, and to the glitch in the lanes where its gate is X or
+// undriven and its source would disturb the current value of the net.
+template <int N>
+typename basic_parallel_simulator<N>::state basic_parallel_simulator<N>::evaluate(int net) const {
+	const state &prev = nets[net];
+
+	state drive;
+	if (flat.nets[net].keep) {
+		drive.lo = prev.lo;
+		drive.hi = prev.hi;
+		drive.s1 = word::ones();
+	} else {
+		drive.lo = word::ones();
+		drive.hi = word::ones();
+		drive.s1 = word::zeros();
+	}
+	drive.s2 = word::zeros();
+	drive.s3 = word::zeros();
+
+	state glitch;
+	glitch.lo = word::ones();
+	glitch.hi = word::ones();
+	glitch.s1 = word::zeros();
+	glitch.s2 = word::zeros();
+	glitch.s3 = word::zeros();
+
+	for (int driver = 0; driver < 2; driver++) {
+		for (int i : flat.drainOf(net, driver)) {
+			const flat_device &dev = flat.devs[i];
+			const state &gate = nets[dev.gate];
+			const state &source = nets[dev.source];
+
+			word is1 = gate.hi & ~gate.lo;
+			word is0 = gate.lo & ~gate.hi;
+			word on = dev.threshold == 1 ? is1 : is0;
+			word maybe = ~(is0 | is1);
+
+			word lo = source.lo;
+			word hi = source.hi;
+			word s1 = source.s1;
+			word s2 = source.s2;
+			word s3 = source.s3;
+
+			// Source is opposite of what this device is designed to drive
+			word back = dev.driver == 1 ? (source.lo & ~source.hi) : (source.hi & ~source.lo);
+			if (base->assume_nobackflow) {
+				lo |= back;
+				hi |= back;
+				s1 &= ~back;
+			}
+			s2 &= ~back;
+			s3 &= ~back;
+
+			word rest = ~back;
+			if (dev.force) {
+				rest &= ~s3;
+			}
+			if (dev.weak) {
+				s2 &= ~rest;
+			}
+			s3 &= ~rest;
+
+			word undriven = lo & hi;
+			resolve(drive, on & ~undriven, lo, hi, s1, s2, s3);
+			resolve(glitch, maybe & ((prev.lo & ~lo) | (prev.hi & ~hi)), lo, hi, s1, s2, s3);
+		}
+	}
+
+	// A glitch at least as strong as the drive makes the net unstable
+	word unstable = ~stronger(drive.s1, drive.s2, drive.s3, glitch) & ((glitch.lo ^ drive.lo) | (glitch.hi ^ drive.hi));
+	drive.lo &= ~unstable;
+	drive.hi &= ~unstable;
+	drive.s1 = select(unstable, glitch.s1, drive.s1);
+	drive.s2 = select(unstable, glitch.s2, drive.s2);
+	drive.s3 = select(unstable, glitch.s3, drive.s3);
+
+	word floating = drive.lo & drive.hi & ~drive.s1;
+	if (base->assume_static) {
+		drive.lo = select(floating, prev.lo, drive.lo);
+		drive.hi = select(floating, prev.hi, drive.hi);
+	} else {
+		drive.lo &= ~floating;
+		drive.hi &= ~floating;
+	}
+	return drive;
+}
+
+template <int N>
+void basic_parallel_simulator<N>::commit(int net, const state &next) {
+	const state &prev = nets[net];
+	word changed = (prev.lo ^ next.lo) | (prev.hi ^ next.hi) | (prev.s1 ^ next.s1) | (prev.s2 ^ next.s2) | (prev.s3 ^ next.s3);
+	if (changed.any()) {
+		for (int r : flat.remote(net)) {
+			nets[r] = next;
+			fanout(r);
+		}
+	}
+}
+
+template <int N>
+bool basic_parallel_simulator<N>::step() {
+	if (pending.empty()) {
+		return false;
+	}
+
+	evaluating.clear();
+	while (not pending.empty()) {
+		evaluating.push_back(pending.pop());
+	}
+	results.resize(evaluating.size());
+	for (int i = 0; i < (int)evaluating.size(); i++) {
+		results[i] = evaluate(evaluating[i]);
+	}
+	for (int i = 0; i < (int)evaluating.size(); i++) {
+		commit(evaluating[i], results[i]);
+	}
+	return true;
+}
+
+template <int N>
+int basic_parallel_simulator<N>::settle(int limit) {
+	int passes = 0;
+	int last = std::numeric_limits<int>::max();
+	while (not pending.empty()) {
+		int net = pending.pop();
+		if (pending.rank[net] <= last) {
+			if (passes == limit) {
+				return -1;
+			}
+			passes++;
+		}
+		last = pending.rank[net];
+		commit(net, evaluate(net));
+	}
+	return passes;
+}
+
+template <int N>
+void basic_parallel_simulator<N>::reset() {
+	flat = flat_netlist(*base);
+
+	state x;
+	x.lo = word::zeros();
+	x.hi = word::zeros();
+	x.s1 = word::zeros();
+	x.s2 = word::zeros();
+	x.s3 = word::zeros();
+	nets.assign(flat.size(), x);
+	pending.clear();
+	pending.reorder(base, flat.levelize());
+
+	for (int i = 0; i < flat.size(); i++) {
+		if (flat.nets[i].driver >= 0) {
+			set(i, word::ones(), flat.nets[i].driver);
+		}
+	}
+	settle();
+
+	for (int i = 0; i < flat.size(); i++) {
+		if (base->netAt(i) == "Reset") {
+			set(i, word::ones(), 1);
+		} else if (base->netAt(i) == "_Reset") {
+			set(i, word::ones(), 0);
+		}
+	}
+	settle();
+}
+
+template <int N>
+void basic_parallel_simulator<N>::run() {
+	for (int i = 0; i < flat.size(); i++) {
+		if (base->netAt(i) == "Reset") {
+			set(i, word::ones(), 0);
+		} else if (base->netAt(i) == "_Reset") {
+			set(i, word::ones(), 1);
+		}
+	}
+	settle();
+}
+
+template struct basic_parallel_simulator<1>;
+template struct basic_parallel_simulator<4>;
+
+}
@@ -0,0 +1,199 @@
+#pragma once
+
+#include "production_rule.h"
+#include "flat_netlist.h"
+#include "simulator.h"
+#include <common/standard.h>
+
+#include <array>
+#include <vector>
+#include <stdint.h>
+
+namespace prs {
+
+// A bit vector of N*64 independent simulation lanes. The operators work
+// word by word so that the compiler can map N=4 onto 256-bit vector
+// registers when they are available.
+template <int N>
+struct lanes {
+	std::array<uint64_t, N> w;
+
+	static lanes fill(uint64_t v) {
+		lanes result;
+		result.w.fill(v);
+		return result;
+	}
+
+	static lanes zeros() {
+		return fill(0ul);
+	}
+
+	static lanes ones() {
+		return fill(~0ul);
+	}
+
+	static lanes bit(int lane) {
+		lanes result = zeros();
+		result.w[lane>>6] = 1ul<<(lane&63);
+		return result;
+	}
+
+	bool get(int lane) const {
+		return (w[lane>>6]>>(lane&63))&1;
+	}
+
+	bool any() const {
+		uint64_t r = 0;
+		for (int i = 0; i < N; i++) {
+			r |= w[i];
+		}
+		return r != 0;
+	}
+
+	lanes operator~() const {
+		lanes result;
+		for (int i = 0; i < N; i++) {
+			result.w[i] = ~w[i];
+		}
+		return result;
+	}
+
+	lanes &operator&=(const lanes &b) {
+		for (int i = 0; i < N; i++) {
+			w[i] &= b.w[i];
+		}
+		return *this;
+	}
+
+	lanes &operator|=(const lanes &b) {
+		for (int i = 0; i < N; i++) {
+			w[i] |= b.w[i];
+		}
+		return *this;
+	}
+
+	lanes &operator^=(const lanes &b) {
+		for (int i = 0; i < N; i++) {
+			w[i] ^= b.w[i];
+		}
+		return *this;
+	}
+
+	friend lanes operator&(lanes a, const lanes &b) {
+		return a &= b;
+	}
+
+	friend lanes operator|(lanes a, const lanes &b) {
+		return a |= b;
+	}
+
+	friend lanes operator^(lanes a, const lanes &b) {
+		return a ^= b;
+	}
+};
+
+// The state of one net across all lanes. Values use the same encoding as
+// simulator::model(), offset by one so that two bits hold them and wired
+// drivers combine with a bitwise and: lo is set for 0 and undriven, hi is
+// set for 1 and undriven, and neither is set for interference (X).
+// Strengths 0 (floating) through 3 (power) are stored as a thermometer code
+// so that comparisons and maximums are bitwise.
+template <int N>
+struct lane_state {
+	lanes<N> lo;
+	lanes<N> hi;
+	lanes<N> s1;  // strength >= 1
+	lanes<N> s2;  // strength >= 2
+	lanes<N> s3;  // strength >= 3
+};
+
+// Simulates up to 64*N independent copies of a circuit at once, each lane
+// with its own input sequence. Every device is evaluated for all lanes with
+// a handful of bitwise operations that follow the value, strength,
+// interference and floating semantics of simulator::model().
+//
+// There are two timing modes, and both ignore device delays and
+// assumptions. step() is unit-delay: it evaluates every net whose inputs
+// changed in the previous step against the same snapshot of the state and
+// commits the results together. settle() is zero-delay: it evaluates one net
+// at a time in levelized order, so that the nets of a feed forward circuit
+// are each evaluated once, and commits each result immediately. A gate at X
+// or undriven is treated as possibly on, which is the glitch path of
+// simulator::model().
+//
+// Typical usage pattern:
+// ```
+// parallel_simulator sim(&prs);
+// sim.reset();
+// for (int lane = 0; lane < sim.width; lane++) {
+//   sim.set(input, lane, vectors[lane]);
+// }
+// sim.settle();
+// int v = sim.get(output, lane);
+// ```
+template <int N>
+struct basic_parallel_simulator {
+	using word = lanes<N>;
+	using state = lane_state<N>;
+
+	static constexpr int width = 64*N;
+
+	basic_parallel_simulator();
+	basic_parallel_simulator(const production_rule_set *base);
+	~basic_parallel_simulator();
+
+	const production_rule_set *base;
+	flat_netlist flat;
+
+	// State of each net, indexed by net ID
+	vector<state> nets;
+
+	// Nets whose inputs changed, ranked by flat_netlist::levelize()
+	worklist pending;
+
+	// Scratch space for step(), kept to avoid reallocating every step
+	vector<int> evaluating;
+	vector<state> results;
+
+	// Drive a net and its remote nets to value at strength in the lanes of
+	// mask, and queue the nets it fans out to
+	void set(int net, const word &mask, int value, int strength=3);
+	void set(int net, int lane, int value, int strength=3);
+
+	// Value (-1, 0, 1, or 2 for undriven) and strength of a net in one lane
+	int get(int net, int lane) const;
+	int strength(int net, int lane) const;
+
+	// Evaluate the pending nets together, returning false if there were none
+	bool step();
+
+	// Evaluate pending nets one at a time until none are left. A pass ends
+	// each time the evaluation order wraps around to an earlier net, which
+	// only happens through feedback. Returns the number of passes, or -1 if
+	// the circuit was still changing after limit passes, for example because
+	// some lane oscillates.
+	int settle(int limit=10000);
+
+	// Reset every lane to the initial state of simulator::reset(): power nets
+	// driven, everything else settled from X, and Reset asserted
+	void reset();
+
+	// Deassert Reset in every lane and settle
+	void run();
+
+	// queue the drains of every device that net is the gate or source of
+	void fanout(int net);
+	// resolve the drivers of net in every lane against the current state
+	state evaluate(int net) const;
+	// store the state of net and its remote nets, queueing their fanout if
+	// anything changed
+	void commit(int net, const state &next);
+};
+
+extern template struct basic_parallel_simulator<1>;
+extern template struct basic_parallel_simulator<4>;
+
+using parallel_simulator = basic_parallel_simulator<1>;
+using wide_parallel_simulator = basic_parallel_simulator<4>;
+
+}
@@ -0,0 +1,155 @@
+#include "partition.h"
+#include "sparse_cube.h"
+
+#include <algorithm>
+#include <map>
+#include <numeric>
+
+namespace prs {
+
+partition::partition() {
+	workers = 1;
+}
+
+partition::partition(const production_rule_set &prs, int workers) {
+	this->workers = std::max(workers, 1);
+	flat_netlist flat(prs);
+
+	// number the regions in use
+	std::map<int, int> regions;
+	for (auto n = prs.nets.begin(); n != prs.nets.end(); n++) {
+		regions.insert(pair<int, int>(n->region, (int)regions.size()));
+	}
+	vector<int> region(flat.size(), 0);
+	for (int i = 0; i < flat.size(); i++) {
+		region[i] = regions[prs.nets[i].region];
+	}
+
+	// Internal nodes are created without a region, so they join the region
+	// of the named net that their stack drives
+	for (int i = 0; i < flat.size(); i++) {
+		int n = i;
+		for (int step = 0; step < flat.size() and flat.nets[n].node; step++) {
+			int next = -1;
+			for (int k = 0; k < 2 and next < 0; k++) {
+				for (int d : flat.sourceOf(n, k)) {
+					next = flat.devs[d].drain;
+					break;
+				}
+			}
+			if (next < 0) {
+				break;
+			}
+			n = next;
+		}
+		region[i] = region[n];
+	}
+
+	// union the regions mentioned by each device assumption with the region
+	// of the device's drain
+	vector<int> group((int)regions.size());
+	std::iota(group.begin(), group.end(), 0);
+	auto find = [&](int r) {
+		while (group[r] != r) {
+			group[r] = group[group[r]];
+			r = group[r];
+		}
+		return r;
+	};
+	for (int i = 0; i < (int)prs.devs.size(); i++) {
+		if (not flat.devs[i].assumes) {
+			continue;
+		}
+		int r0 = find(region[flat.devs[i].drain]);
+		for (auto c = prs.devs[i].attr.assume.cubes.begin(); c != prs.devs[i].attr.assume.cubes.end(); c++) {
+			sparse_cube lits(*c);
+			for (auto l = lits.begin(); l != lits.end(); l++) {
+				if (l->var < flat.size()) {
+					group[find(region[l->var])] = r0;
+				}
+			}
+		}
+	}
+
+	// weigh each group by the devices it evaluates, then hand the heaviest
+	// remaining group to the least loaded worker
+	vector<uint64_t> weight(group.size(), 0);
+	for (int i = 0; i < (int)flat.devs.size(); i++) {
+		weight[find(region[flat.devs[i].drain])]++;
+	}
+	vector<int> order;
+	for (int r = 0; r < (int)group.size(); r++) {
+		if (find(r) == r) {
+			order.push_back(r);
+		}
+	}
+	std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+		return weight[a] > weight[b];
+	});
+	vector<int> assigned(group.size(), 0);
+	vector<uint64_t> load(this->workers, 0);
+	for (auto r = order.begin(); r != order.end(); r++) {
+		int w = (int)(std::min_element(load.begin(), load.end()) - load.begin());
+		assigned[*r] = w;
+		load[w] += weight[*r] + 1;
+	}
+
+	owner.assign(flat.size(), -1);
+	for (int i = 0; i < flat.size(); i++) {
+		if (flat.nets[i].driver < 0) {
+			owner[i] = assigned[find(region[i])];
+		}
+	}
+
+	importers.assign(flat.size(), vector<int>());
+	for (int i = 0; i < flat.size(); i++) {
+		if (owner[i] < 0) {
+			continue;
+		}
+		// Every remote copy of a drain evaluates all of the drivers of the
+		// group, so each of their owners reads the gate and source
+		vector<int> &imp = importers[i];
+		auto readers = [&](int d) {
+			for (int r : flat.remote(flat.devs[d].drain)) {
+				imp.push_back(owner[r]);
+			}
+		};
+		for (int r : flat.remote(i)) {
+			imp.push_back(owner[r]);
+			for (int k = 0; k < 2; k++) {
+				for (int d : flat.gateOf(r, k)) {
+					readers(d);
+				}
+				for (int d : flat.sourceOf(r, k)) {
+					readers(d);
+				}
+			}
+		}
+		std::sort(imp.begin(), imp.end());
+		imp.erase(std::unique(imp.begin(), imp.end()), imp.end());
+		imp.erase(std::remove_if(imp.begin(), imp.end(), [&](int w) {
+			return w < 0 or w == owner[i];
+		}), imp.end());
+	}
+}
+
+partition::~partition() {
+}
+
+vector<bool> partition::owned(int w) const {
+	vector<bool> result(owner.size(), false);
+	for (int i = 0; i < (int)owner.size(); i++) {
+		result[i] = owner[i] == w;
+	}
+	return result;
+}
+
+vector<bool> partition::exported(int w) const {
+	vector<bool> result(owner.size(), false);
+	for (int i = 0; i < (int)owner.size(); i++) {
+		result[i] = owner[i] == w and not importers[i].empty();
+	}
+	return result;
+}
+
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "production_rule.h"
+#include "flat_netlist.h"
+#include <common/standard.h>
+
+#include <vector>
+#include <stdint.h>
+
+namespace prs {
+
+// Splits the nets of a production rule set between workers for parallel
+// simulation. Whole isochronic regions (net::region) are assigned to a
+// worker, balancing the number of devices each worker evaluates, and a
+// worker evaluates the drivers of the nets it owns. Regions tied together
+// by a device assumption are kept on the same worker, since assumptions
+// act on the state of every net they mention.
+//
+// A worker must see every change to a net it reads but does not own, which
+// are the remote copies of its nets and the gates and sources of its
+// devices. The owner of a net forwards its changes to the workers listed in
+// importers.
+struct partition {
+	partition();
+	partition(const production_rule_set &prs, int workers);
+	~partition();
+
+	int workers;
+
+	// Worker that owns each net, -1 for power nets, which never change after
+	// reset and are held by every worker
+	vector<int> owner;
+
+	// For each net, the other workers that read it
+	vector<vector<int> > importers;
+
+	// Nets owned by worker w, in the form of simulator::owned
+	vector<bool> owned(int w) const;
+	// Owned nets of worker w that have importers, in the form of
+	// simulator::exported
+	vector<bool> exported(int w) const;
+};
+
+}
@@ -285,20 +285,45 @@ int production_rule_set::netCount() const {
 // Groups nets by electrical equivalence
 //
 // Identifies sets of nets that are connected as remotes and
-// therefore electrically equivalent.
+// therefore electrically equivalent. The remote lists are merged with a
+// union-find, so this runs in near linear time in the number of nets
+// and remote connections rather than searching every group for every net.
 //
-// @return Vector of net groups where each group contains indices of equivalent nets
+// @return Vector of net groups where each group contains indices of equivalent nets,
+// ordered by their lowest net
 vector<vector<int> > production_rule_set::remote_groups() const {
-	vector<vector<int> > groups;
+	vector<int> parent(nets.size());
+	for (int i = 0; i < (int)nets.size(); i++) {
+		parent[i] = i;
+	}
+	auto find = [&](int i) {
+		while (parent[i] != i) {
+			parent[i] = parent[parent[i]];
+			i = parent[i];
+		}
+		return i;
+	};
 
 	for (int i = 0; i < (int)nets.size(); i++) {
-		bool found = false;
-		for (int j = 0; j < (int)groups.size() and not found; j++) {
-			found = (find(groups[j].begin(), groups[j].end(), i) != groups[j].end());
+		for (auto j = nets[i].remote.begin(); j != nets[i].remote.end(); j++) {
+			if (*j >= 0 and *j < (int)nets.size()) {
+				int r0 = find(i);
+				int r1 = find(*j);
+				// keep the lowest net as the root
+				parent[std::max(r0, r1)] = std::min(r0, r1);
+			}
 		}
-		if (not found) {
-			groups.push_back(nets[i].remote);
+	}
+
+	vector<vector<int> > groups;
+	vector<int> index(nets.size(), -1);
+	for (int i = 0; i < (int)nets.size(); i++) {
+		int r = find(i);
+		if (index[r] < 0) {
+			index[r] = (int)groups.size();
+			groups.push_back(vector<int>());
 		}
+		groups[index[r]].push_back(i);
 	}
 
 	return groups;
@@ -0,0 +1,268 @@
+#pragma once
+
+#include "calendar_queue.h"
+
+#include <vector>
+#include <array>
+#include <stdint.h>
+#include <limits>
+#include <bit>
+
+// A radix heap is a monotone priority queue. Every queued event has a time at
+// or after now, the time of the last event removed from the front, and an
+// event with time t lives in bucket bit_width(t^now). Bucket 0 holds the
+// events at exactly now, and each bucket b above it holds events that share
+// the top 64-b bits of now. Popping from an empty bucket 0 finds the minimum
+// of the lowest non-empty bucket, makes that the new now, and redistributes
+// that bucket into the buckets below it. Each event can only move down, so
+// push and pop are O(1) amortized, with no tuning to the spread of the delays.
+//
+// Buckets are doubly linked lists over the same event storage that
+// calendar_queue uses, so handles are stable and an event may be removed or
+// moved to an earlier time in O(1). An event pushed before now is still
+// accepted, but it moves now back and redistributes every queued event.
+//
+// The interface mirrors calendar_queue so that either can back the
+// simulator.
+template <typename T, typename P=default_priority<T>, typename S=arena_events<T> >
+struct radix_heap {
+	using event = typename S::event;
+	using handle = typename S::handle;
+	static constexpr handle nil = S::nil;
+
+	P priority;
+
+	uint64_t count;
+	uint64_t now;
+
+	S events;
+
+	// bucket b holds events with bit_width(time^now) == b, and bit b-1 of
+	// occupied is set when bucket b is non-empty for b > 0
+	std::array<std::pair<handle, handle>, 65> buckets;
+	uint64_t occupied;
+
+	radix_heap(P priority=P()) {
+		this->priority = priority;
+		this->count = 0;
+		this->now = std::numeric_limits<uint64_t>::max();
+		this->occupied = 0;
+		buckets.fill(std::pair<handle, handle>(nil, nil));
+	}
+
+	radix_heap(const radix_heap &q) {
+		*this = q;
+	}
+
+	radix_heap &operator=(const radix_heap &q) {
+		priority = q.priority;
+		count = q.count;
+		now = q.now;
+		events = q.events;
+		buckets = q.buckets;
+		for (auto b = buckets.begin(); b != buckets.end(); b++) {
+			b->first = events.rebase(b->first, q.events);
+			b->second = events.rebase(b->second, q.events);
+		}
+		occupied = q.occupied;
+		return *this;
+	}
+
+	~radix_heap() {
+	}
+
+	int bucketof(uint64_t time) {
+		return std::bit_width(time^now);
+	}
+
+	// Append e to the end of bucket b. Bucket 0 is kept in order of tie so
+	// that events at the same time come out in the same order as they would
+	// from calendar_queue. Unlike calendar_queue, events with the same time
+	// and the same tie come out in no particular order, since redistribution
+	// does not keep the order they were pushed in. The simulator never has
+	// two such events because the tie is the net.
+	void link(int b, handle e) {
+		handle p = buckets[b].second;
+		if (b == 0) {
+			uint64_t k = priority_tie(priority, events[e].value);
+			while (p != nil and priority_tie(priority, events[p].value) > k) {
+				p = events[p].prev;
+			}
+		}
+
+		handle n = p == nil ? buckets[b].first : events[p].next;
+		events[e].prev = p;
+		events[e].next = n;
+		if (p == nil) {
+			buckets[b].first = e;
+		} else {
+			events[p].next = e;
+		}
+		if (n == nil) {
+			buckets[b].second = e;
+		} else {
+			events[n].prev = e;
+		}
+		if (b > 0) {
+			occupied |= 1ul<<(b-1);
+		}
+	}
+
+	void unlink(int b, handle e) {
+		if (events[e].prev == nil) {
+			buckets[b].first = events[e].next;
+		} else {
+			events[events[e].prev].next = events[e].next;
+		}
+
+		if (events[e].next == nil) {
+			buckets[b].second = events[e].prev;
+		} else {
+			events[events[e].next].prev = events[e].prev;
+		}
+		if (buckets[b].first == nil and b > 0) {
+			occupied &= ~(1ul<<(b-1));
+		}
+		events[e].next = nil;
+		events[e].prev = nil;
+	}
+
+	// Move now back to time and redistribute every queued event
+	void rewind(uint64_t time) {
+		std::vector<handle> all;
+		all.reserve(count);
+		for (auto b = buckets.begin(); b != buckets.end(); b++) {
+			for (handle e = b->first; e != nil; e = events[e].next) {
+				all.push_back(e);
+			}
+			b->first = nil;
+			b->second = nil;
+		}
+		occupied = 0;
+		now = time;
+		for (auto e = all.begin(); e != all.end(); e++) {
+			link(bucketof(priority(events[*e].value)), *e);
+		}
+	}
+
+	void add(handle e) {
+		uint64_t t = priority(events[e].value);
+		if (t < now) {
+			if (count == 0) {
+				now = t;
+			} else {
+				rewind(t);
+			}
+		}
+		link(bucketof(t), e);
+		count++;
+	}
+
+	handle rem(handle e) {
+		if (e == nil) {
+			return nil;
+		}
+		unlink(bucketof(priority(events[e].value)), e);
+		count--;
+		return e;
+	}
+
+	// Return the earliest event, redistributing the lowest non-empty bucket
+	// if there are no events at now
+	handle next() {
+		if (count == 0) {
+			return nil;
+		}
+		if (buckets[0].first == nil) {
+			int b = std::countr_zero(occupied)+1;
+			handle e = buckets[b].first;
+			uint64_t m = priority(events[e].value);
+			for (e = events[e].next; e != nil; e = events[e].next) {
+				m = std::min(m, priority(events[e].value));
+			}
+
+			e = buckets[b].first;
+			buckets[b].first = nil;
+			buckets[b].second = nil;
+			occupied &= ~(1ul<<(b-1));
+			now = m;
+			while (e != nil) {
+				handle n = events[e].next;
+				link(bucketof(priority(events[e].value)), e);
+				e = n;
+			}
+		}
+		return buckets[0].first;
+	}
+
+	// Move an event to an earlier time
+	void set(handle e, T value) {
+		if (priority(value) < priority(events[e].value)) {
+			rem(e);
+			events[e].value = value;
+			add(e);
+		}
+	}
+
+	event &operator[](handle e) {
+		return events[e];
+	}
+
+	handle push(T value) {
+		handle result = events.alloc();
+		events[result].value = value;
+		add(result);
+		return result;
+	}
+
+	template <typename I>
+	std::vector<handle> push_batch(I first, I last) {
+		std::vector<handle> result;
+		push_batch(first, last, result);
+		return result;
+	}
+
+	template <typename I>
+	void push_batch(I first, I last, std::vector<handle> &result) {
+		result.clear();
+		for (I i = first; i != last; i++) {
+			result.push_back(push(*i));
+		}
+	}
+
+	T pop(handle e) {
+		e = rem(e);
+		if (e == nil) {
+			return T();
+		}
+		events[e].gen += 2;
+		events.free(e);
+		return events[e].value;
+	}
+
+	T pop() {
+		return pop(next());
+	}
+
+	// Radix heap removal is already O(1), so cancelling an event removes it
+	// immediately.
+	void cancel(handle e) {
+		pop(e);
+	}
+
+	uint64_t size() {
+		return count;
+	}
+
+	bool empty() {
+		return count == 0;
+	}
+
+	void clear() {
+		events.clear();
+		buckets.fill(std::pair<handle, handle>(nil, nil));
+		occupied = 0;
+		now = 0;
+		count = 0;
+	}
+};
@@ -0,0 +1,214 @@
+#include "region_simulator.h"
+
+#include <algorithm>
+#include <barrier>
+#include <thread>
+
+namespace prs {
+
+// Firing time of the next event in a simulator's queue
+static uint64_t next_time(simulator &sim) {
+	simulator::queue::handle h = sim.enabled.next();
+	if (h == simulator::queue::nil) {
+		return std::numeric_limits<uint64_t>::max();
+	}
+	return sim.enabled[h].value.fire_at;
+}
+
+// Net of the next event in a simulator's queue if it fires at time t, or
+// the maximum int if it fires later
+static int next_net(simulator &sim, uint64_t t) {
+	simulator::queue::handle h = sim.enabled.next();
+	if (h == simulator::queue::nil or sim.enabled[h].value.fire_at != t) {
+		return std::numeric_limits<int>::max();
+	}
+	return sim.enabled[h].value.net;
+}
+
+region_simulator::region_simulator() {
+	base = NULL;
+	now = 0;
+}
+
+region_simulator::region_simulator(const production_rule_set *base, int workers) {
+	this->base = base;
+	this->now = 0;
+	part = partition(*base, workers);
+
+	sims.assign(part.workers, simulator(base));
+	for (int w = 0; w < part.workers; w++) {
+		sims[w].owned = part.owned(w);
+		sims[w].exported = part.exported(w);
+		sims[w].delay.policy = delay_model::fixed_max;
+	}
+
+	mail.assign(part.workers*part.workers, vector<enabled_event>());
+	busy[0].assign(part.workers, 0);
+	busy[1].assign(part.workers, 0);
+	next.assign(part.workers, std::numeric_limits<uint64_t>::max());
+	head.assign(part.workers, std::numeric_limits<int>::max());
+}
+
+region_simulator::~region_simulator() {
+}
+
+int region_simulator::get(int net) const {
+	int w = part.owner[net] < 0 ? 0 : part.owner[net];
+	return sims[w].encoding.get(net);
+}
+
+int region_simulator::strength(int net) const {
+	int w = part.owner[net] < 0 ? 0 : part.owner[net];
+	return 2-sims[w].strength.get(net);
+}
+
+void region_simulator::set(int net, int value, int strength, bool stable) {
+	for (int w = 0; w < part.workers; w++) {
+		if (part.owner[net] < 0 or part.owner[net] == w) {
+			sims[w].now = now;
+			sims[w].set(net, value, strength, stable);
+		}
+	}
+	exchange();
+}
+
+uint64_t region_simulator::earliest() {
+	uint64_t result = std::numeric_limits<uint64_t>::max();
+	for (auto s = sims.begin(); s != sims.end(); s++) {
+		result = std::min(result, next_time(*s));
+	}
+	return result;
+}
+
+bool region_simulator::send(int w) {
+	vector<enabled_event> &outbox = sims[w].outbox;
+	bool sent = false;
+	for (auto e = outbox.begin(); e != outbox.end(); e++) {
+		for (int to : part.importers[e->net]) {
+			mail[w*part.workers + to].push_back(*e);
+			sent = true;
+		}
+	}
+	outbox.clear();
+	return sent;
+}
+
+// Changes are applied in the order of the worker that sent them, so the
+// result does not depend on how the threads were scheduled
+void region_simulator::receive(int w, uint64_t t) {
+	simulator &sim = sims[w];
+	for (int from = 0; from < part.workers; from++) {
+		vector<enabled_event> &box = mail[from*part.workers + w];
+		for (auto e = box.begin(); e != box.end(); e++) {
+			sim.now = t;
+			sim.set(e->net, e->value, e->strength, e->stable);
+		}
+		box.clear();
+	}
+}
+
+void region_simulator::exchange() {
+	bool sent = true;
+	while (sent) {
+		sent = false;
+		for (int w = 0; w < part.workers; w++) {
+			sent = send(w) or sent;
+		}
+		for (int w = 0; w < part.workers; w++) {
+			receive(w, now);
+		}
+	}
+}
+
+bool region_simulator::advance(uint64_t until) {
+	const int n = part.workers;
+	std::barrier<> sync(n);
+
+	auto work = [&](int w) {
+		simulator &sim = sims[w];
+		int parity = 0;
+		while (true) {
+			next[w] = next_time(sim);
+			sync.arrive_and_wait();
+			uint64_t t = *std::min_element(next.begin(), next.end());
+			if (t > until or t == std::numeric_limits<uint64_t>::max()) {
+				break;
+			}
+			if (w == 0) {
+				now = t;
+			}
+
+			while (true) {
+				// Find the lowest net with an event at time t, and the lowest
+				// one held by any other worker
+				head[w] = next_net(sim, t);
+				sync.arrive_and_wait();
+				int first = head[w];
+				int other = std::numeric_limits<int>::max();
+				for (int v = 0; v < n; v++) {
+					if (v != w) {
+						other = std::min(other, head[v]);
+					}
+				}
+				first = std::min(first, other);
+				if (first == std::numeric_limits<int>::max()) {
+					break;
+				}
+
+				// The worker holding it fires events in order of net until one
+				// reaches another worker or the next belongs to another worker
+				if (head[w] == first) {
+					do {
+						sim.fire();
+					} while (sim.outbox.empty() and next_net(sim, t) < other);
+				}
+
+				// Delta cycles, until no worker forwards anything
+				bool more = true;
+				while (more) {
+					busy[parity][w] = send(w);
+					sync.arrive_and_wait();
+					receive(w, t);
+					sync.arrive_and_wait();
+					more = std::find(busy[parity].begin(), busy[parity].end(), 1) != busy[parity].end();
+					parity = 1-parity;
+				}
+			}
+		}
+	};
+
+	vector<std::thread> threads;
+	for (int w = 1; w < n; w++) {
+		threads.push_back(std::thread(work, w));
+	}
+	work(0);
+	for (auto t = threads.begin(); t != threads.end(); t++) {
+		t->join();
+	}
+
+	return earliest() != std::numeric_limits<uint64_t>::max();
+}
+
+void region_simulator::reset() {
+	now = 0;
+	for (auto m = mail.begin(); m != mail.end(); m++) {
+		m->clear();
+	}
+	for (auto s = sims.begin(); s != sims.end(); s++) {
+		s->outbox.clear();
+		s->reset();
+	}
+	exchange();
+}
+
+void region_simulator::run() {
+	for (int i = 0; i < (int)base->nets.size(); i++) {
+		if (base->netAt(i) == "Reset") {
+			set(i, 0);
+		} else if (base->netAt(i) == "_Reset") {
+			set(i, 1);
+		}
+	}
+}
+
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "production_rule.h"
+#include "simulator.h"
+#include "partition.h"
+#include <common/standard.h>
+
+#include <limits>
+
+namespace prs {
+
+// Runs one simulator per worker thread, each evaluating the drivers of the
+// regions that partition assigned to it, and forwards the changes on nets
+// that cross between workers.
+//
+// The workers advance in lock step through the firing times of the circuit.
+// At each time, the events fire in order of net, as they would from the
+// queue of a single simulator. The worker that holds the lowest net fires
+// its events until one of them changes a net that another worker reads, or
+// until the next net belongs to another worker. Then the workers apply the
+// changes forwarded to them, which may in turn fire instantly and be
+// forwarded again, until none are left, and the worker with the lowest net
+// goes next. A worker only writes to its own outgoing mailboxes and only
+// reads from its incoming ones, with a barrier between the two, so the
+// mailboxes need no locks. Synchronizing within each firing time rather than
+// across a lookahead window is necessary because simulator::evaluate()
+// releases a net the moment its last driver turns off, so a change may cross
+// to another worker with no delay at all. The workers fire runs of events
+// that stay within their own regions without stopping, and evaluate the
+// changes forwarded to them in parallel.
+//
+// Each simulator takes exactly delay_max for every transition, because a
+// random delay would depend on the order in which a worker happened to
+// schedule its transitions. The result is then the same as running a single
+// simulator with delay_model::fixed_max, including which of two events at
+// the same time cancels or interferes with the other. There are two
+// exceptions. When a forwarded change fires instantly in the worker that
+// receives it, that worker evaluates its own nets in order after the sender
+// has evaluated its own, rather than in one pass over every net. And
+// require_stable and require_noninterfering may report an error once for
+// every worker that sees the offending net.
+struct region_simulator {
+	region_simulator();
+	region_simulator(const production_rule_set *base, int workers);
+	~region_simulator();
+
+	const production_rule_set *base;
+	partition part;
+
+	// One simulator per worker
+	vector<simulator> sims;
+
+	// Firing time of the last events that were processed
+	uint64_t now;
+
+	// mail[from*workers + to] holds the changes forwarded from one worker to
+	// another that have yet to be applied
+	vector<vector<enabled_event> > mail;
+
+	// Set by each worker when it forwarded changes during a delta cycle,
+	// double buffered by the parity of the cycle
+	vector<char> busy[2];
+	// Next firing time of each worker
+	vector<uint64_t> next;
+	// Net of the next event of each worker at the current firing time
+	vector<int> head;
+
+	// Value, and strength, of a net as seen by the worker that owns it
+	int get(int net) const;
+	int strength(int net) const;
+
+	// Set a value at the current time and forward it to every worker that
+	// reads the net
+	void set(int net, int value, int strength=3, bool stable=true);
+
+	// Process every event that fires at or before until. Returns false if
+	// there are no events left.
+	bool advance(uint64_t until=std::numeric_limits<uint64_t>::max());
+
+	// Earliest firing time over all workers, or the maximum uint64_t if
+	// there are no pending events
+	uint64_t earliest();
+
+	// Move the changes recorded in a worker's outbox into its mailboxes.
+	// Returns true if anything was sent.
+	bool send(int w);
+	// Apply the changes forwarded to a worker at time t
+	void receive(int w, uint64_t t);
+	// Forward changes between the workers on the calling thread until none
+	// are left
+	void exchange();
+
+	void reset();
+	void run();
+};
+
+}
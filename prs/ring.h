@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <stdint.h>
+
+// A bounded single producer, single consumer queue that needs no locks. The
+// values live in one array whose size is a power of two, allocated up front.
+// The producer writes the slot at tail and publishes it by storing the new
+// tail with release ordering, and the consumer reads up to the published
+// tail and hands the slots back by storing its new head the same way. Each
+// side keeps a copy of the other's index and only reloads it when the ring
+// looks full or empty, so the two sides rarely touch the same cache line.
+//
+// Unlike mailbox, push() never allocates. It fails when the ring is full
+// and leaves the choice between waiting and dropping the value to the
+// caller.
+template <typename T>
+struct ring {
+	std::vector<T> values;
+	uint64_t mask;
+
+	// Written by the consumer
+	alignas(64) std::atomic<uint64_t> head;
+	uint64_t tail_cache;
+
+	// Written by the producer
+	alignas(64) std::atomic<uint64_t> tail;
+	uint64_t head_cache;
+
+	ring(size_t capacity=1024) {
+		resize(capacity);
+	}
+
+	ring(const ring &r) = delete;
+	ring &operator=(const ring &r) = delete;
+
+	~ring() {
+	}
+
+	// Round capacity up to a power of two and empty the ring. Neither side
+	// may be running.
+	void resize(size_t capacity) {
+		size_t n = 1;
+		while (n < capacity) {
+			n <<= 1;
+		}
+		values.assign(n, T());
+		mask = n-1;
+		head.store(0, std::memory_order_relaxed);
+		tail.store(0, std::memory_order_relaxed);
+		tail_cache = 0;
+		head_cache = 0;
+	}
+
+	size_t capacity() const {
+		return values.size();
+	}
+
+	// Called by the producer only. Returns false if the ring is full.
+	bool push(const T &value) {
+		uint64_t t = tail.load(std::memory_order_relaxed);
+		if (t - head_cache == values.size()) {
+			head_cache = head.load(std::memory_order_acquire);
+			if (t - head_cache == values.size()) {
+				return false;
+			}
+		}
+		values[t & mask] = value;
+		tail.store(t+1, std::memory_order_release);
+		return true;
+	}
+
+	// Called by the consumer only. Returns false if there is nothing to read.
+	bool pop(T &value) {
+		uint64_t h = head.load(std::memory_order_relaxed);
+		if (h == tail_cache) {
+			tail_cache = tail.load(std::memory_order_acquire);
+			if (h == tail_cache) {
+				return false;
+			}
+		}
+		value = values[h & mask];
+		head.store(h+1, std::memory_order_release);
+		return true;
+	}
+};
@@ -14,11 +14,11 @@ enabled_transition::enabled_transition() {
 	this->stable = true;
 }
 
-enabled_transition::enabled_transition(uint64_t fire_at, boolean::cube assume, boolean::cube guard, int net, int value, int strength, bool stable) {
+enabled_transition::enabled_transition(uint64_t fire_at, sparse_cube assume, sparse_cube guard, int net, int value, int strength, bool stable) {
 	this->fire_at = fire_at;
 	
-	this->assume = assume;
-	this->guard = guard;
+	this->assume = std::move(assume);
+	this->guard = std::move(guard);
 	this->net = net;
 	this->value = value;
 	this->strength = strength;
@@ -29,7 +29,7 @@ enabled_transition::~enabled_transition() {
 }
 
 string enabled_transition::to_string(const production_rule_set *base) {
-	string result = export_expression(guard, *base).to_string() + "->" + base->netAt(net);
+	string result = export_expression(guard.cube(), *base).to_string() + "->" + base->netAt(net);
 	// Value encoding in asynchronous circuit notation:
 	// -1: Interference or instability (represented as ~)
 	// 0: Low logic level (represented as -)
@@ -55,30 +55,175 @@ string enabled_transition::to_string(const production_rule_set *base) {
 	}
 
 	if (not assume.is_tautology()) {
-		result += " {" + export_expression(assume, *base).to_string() + "}";
+		result += " {" + export_expression(assume.cube(), *base).to_string() + "}";
 	}
 
 	return result;
 }
 
-bool operator<(enabled_transition t0, enabled_transition t1) {
+bool operator<(const enabled_transition &t0, const enabled_transition &t1) {
 	return t0.fire_at < t1.fire_at;
 }
 
-bool operator>(enabled_transition t0, enabled_transition t1) {
+bool operator>(const enabled_transition &t0, const enabled_transition &t1) {
 	return t0.fire_at > t1.fire_at;
 }
 
-simulator::simulator()
+enabled_event::enabled_event() {
+	this->fire_at = 0;
+	this->net = 0;
+	this->value = 2;
+	this->strength = 0;
+	this->stable = true;
+}
+
+enabled_event::enabled_event(uint64_t fire_at, int net, int value, int strength, bool stable) {
+	this->fire_at = fire_at;
+	this->net = net;
+	this->value = (int8_t)value;
+	this->strength = (int8_t)strength;
+	this->stable = stable;
+}
+
+enabled_event::~enabled_event() {
+}
+
+run_result::run_result() {
+	reason = drained;
+	fired = 0;
+	net = -1;
+}
+
+run_result::~run_result() {
+}
+
+state_chunk::state_chunk() {
+}
+
+state_chunk::~state_chunk() {
+}
+
+simulator_state::simulator_state() {
+	for (int c = 0; c < 3; c++) {
+		size[c] = 0;
+	}
+	now = 0;
+}
+
+simulator_state::~simulator_state() {
+}
+
+worklist::worklist() {
+	base = NULL;
+	first = 0;
+	count = 0;
+}
+
+worklist::~worklist() {
+}
+
+void worklist::reorder(const production_rule_set *base) {
+	vector<int> order;
+	for (int node = 1; node >= 0 and base != NULL; node--) {
+		for (int i = 0; i < (int)base->nets.size(); i++) {
+			if (base->nets[i].isNode() == (node == 1)) {
+				order.push_back(i);
+			}
+		}
+	}
+	reorder(base, order);
+}
+
+// Any nets that are already waiting are carried over into the new order.
+void worklist::reorder(const production_rule_set *base, const vector<int> &order) {
+	vector<int> prev;
+	while (not empty()) {
+		prev.push_back(pop());
+	}
+
+	this->base = base;
+	this->order = order;
+	rank.assign(order.size(), 0);
+	for (int i = 0; i < (int)order.size(); i++) {
+		rank[order[i]] = i;
+	}
+	waiting.resize(order.size());
+	first = order.size();
+	count = 0;
+
+	for (auto i = prev.begin(); i != prev.end(); i++) {
+		push(*i);
+	}
+}
+
+// Nets past the end of the order, such as ones created after it was
+// computed, are ranked after every net already in it. This keeps a custom
+// order and the nets already waiting.
+void worklist::extend(int n) {
+	for (int i = (int)rank.size(); i < n; i++) {
+		rank.push_back((int)order.size());
+		order.push_back(i);
+	}
+	waiting.grow(order.size());
+}
+
+void worklist::push(int net) {
+	if (net >= (int)rank.size()) {
+		extend(net+1);
+	}
+	uint64_t r = rank[net];
+	if (not waiting.marked(r)) {
+		waiting.mark(r);
+		first = std::min(first, r);
+		count++;
+	}
+}
+
+int worklist::pop() {
+	first = waiting.find(first, order.size());
+	waiting.unmark(first);
+	count--;
+	return order[first];
+}
+
+bool worklist::empty() const {
+	return count == 0;
+}
+
+void worklist::clear() {
+	while (not empty()) {
+		pop();
+	}
+}
+
+template <typename Q>
+basic_simulator<Q>::basic_simulator()
 {
 	base = NULL;
 	debug = false;
+	tracer = nullptr;
+	checker = nullptr;
+	now = 0;
+	flat = std::make_shared<const flat_netlist>();
+	adapt();
+}
+
+template <typename Q>
+basic_simulator<Q>::basic_simulator(const production_rule_set *base, bool debug) : basic_simulator(base, base == NULL ? std::make_shared<const flat_netlist>() : std::make_shared<const flat_netlist>(*base), debug)
+{
 }
 
-simulator::simulator(const production_rule_set *base, bool debug)
+template <typename Q>
+basic_simulator<Q>::basic_simulator(const production_rule_set *base, std::shared_ptr<const flat_netlist> flat, bool debug)
 {
 	this->base = base;
 	this->debug = debug;
+	this->tracer = nullptr;
+	this->checker = nullptr;
+	this->now = 0;
+	this->flat = flat;
+	adapt();
+	dirty.reorder(base);
 	if (base != NULL) {
 		for (int i = 0; i < (int)base->nets.size(); i++) {
 			if (base->nets[i].driver == 1) {
@@ -95,20 +240,205 @@ simulator::simulator(const production_rule_set *base, bool debug)
 	}
 }
 
-simulator::~simulator()
+template <typename Q>
+basic_simulator<Q>::~basic_simulator()
 {
 
 }
 
-simulator::queue::event* &simulator::at(int net) {
+// Delays scale with each circuit's delay_max, so a calendar queue backend
+// should pick its day width from the event gaps it sees. Other backends have
+// nothing to tune.
+template <typename Q>
+void basic_simulator<Q>::adapt() {
+	if constexpr (requires (Q q) { q.policy.adapt; }) {
+		enabled.policy.adapt = true;
+	}
+}
+
+template <typename Q>
+typename basic_simulator<Q>::queue::handle &basic_simulator<Q>::at(int net) {
+	touch(net);
 	return nets[net];
 }
 
+template <typename Q>
+void basic_simulator<Q>::touch() {
+	int n = (int)nets.size();
+	n = std::max(n, (int)encoding.values.size()*16);
+	n = std::max(n, (int)global.values.size()*16);
+	n = std::max(n, (int)strength.values.size()*16);
+	for (int net = 0; net < n; net += simulator_state::width) {
+		touch(net);
+	}
+}
+
+// Only the chunks touched since the last snapshot are saved again. The
+// pending transitions must be in the queue to be saved, so the batch is
+// flushed first.
+template <typename Q>
+simulator_state basic_simulator<Q>::snapshot() {
+	flush();
+
+	simulator_state result = last;
+	boolean::cube *cubes[3] = {&encoding, &global, &strength};
+	int n = ((int)nets.size() + simulator_state::width-1)/simulator_state::width;
+	for (int c = 0; c < 3; c++) {
+		result.size[c] = (int)cubes[c]->values.size();
+		n = std::max(n, (result.size[c]*16 + simulator_state::width-1)/simulator_state::width);
+	}
+	result.chunks.resize(n);
+	result.now = now;
+	result.rng = delay.rng;
+
+	for (int k = (int)last.chunks.size(); k < n; k++) {
+		touch(k*simulator_state::width);
+	}
+
+	const int words = simulator_state::width/16;
+	for (int k : changed) {
+		if (k >= n) {
+			continue;
+		}
+
+		std::shared_ptr<state_chunk> chunk(new state_chunk());
+		for (int c = 0; c < 3; c++) {
+			const vector<unsigned int> &live = cubes[c]->values;
+			int lo = std::min(k*words, (int)live.size());
+			int hi = std::min((k+1)*words, (int)live.size());
+			chunk->values[c].assign(live.begin()+lo, live.begin()+hi);
+		}
+
+		int hi = std::min((k+1)*simulator_state::width, (int)nets.size());
+		for (int net = k*simulator_state::width; net < hi; net++) {
+			if (nets[net] != queue::nil) {
+				chunk->events.push_back(enabled[nets[net]].value);
+				chunk->terms.push_back(terms[net]);
+			}
+		}
+		result.chunks[k] = chunk;
+	}
+
+	for (int k : changed) {
+		touched[k] = false;
+	}
+	changed.clear();
+	last = result;
+	return result;
+}
+
+// A chunk only needs to be rewritten if it was touched since the last
+// snapshot or restore, or if s saved a different copy of it than that one
+// did. Rewriting a chunk cancels the pending transitions of its nets and
+// pushes the ones that s saved.
+template <typename Q>
+void basic_simulator<Q>::restore(const simulator_state &s) {
+	flush();
+
+	boolean::cube *cubes[3] = {&encoding, &global, &strength};
+	for (int c = 0; c < 3; c++) {
+		cubes[c]->values.resize(s.size[c], 0xFFFFFFFF);
+	}
+
+	int n = std::max(last.chunks.size(), s.chunks.size());
+	for (int k = 0; k < n; k++) {
+		if (k >= (int)last.chunks.size() or k >= (int)s.chunks.size() or last.chunks[k] != s.chunks[k]) {
+			touch(k*simulator_state::width);
+		}
+	}
+
+	const int words = simulator_state::width/16;
+	// The list grows as cancel() touches nets, but only within chunks that
+	// are already listed
+	for (int i = 0; i < (int)changed.size(); i++) {
+		int k = changed[i];
+		int hi = std::min((k+1)*simulator_state::width, (int)nets.size());
+		for (int net = k*simulator_state::width; net < hi; net++) {
+			cancel(net);
+		}
+
+		if (k >= (int)s.chunks.size() or not s.chunks[k]) {
+			continue;
+		}
+		const state_chunk &chunk = *s.chunks[k];
+		for (int c = 0; c < 3; c++) {
+			std::copy(chunk.values[c].begin(), chunk.values[c].end(), cubes[c]->values.begin() + k*words);
+		}
+		for (int j = 0; j < (int)chunk.events.size(); j++) {
+			int net = chunk.events[j].net;
+			if (net >= (int)nets.size()) {
+				nets.resize(net+1, queue::nil);
+				terms.resize(net+1);
+				batched.resize(net+1, -1);
+			}
+			nets[net] = enabled.push(chunk.events[j]);
+			terms[net] = chunk.terms[j];
+		}
+	}
+
+	for (int k : changed) {
+		touched[k] = false;
+	}
+	changed.clear();
+	now = s.now;
+	delay.rng = s.rng;
+	last = s;
+}
+
+template <typename Q>
+enabled_event *basic_simulator<Q>::pending(int net) {
+	if (net < 0 or net >= (int)nets.size()) {
+		return nullptr;
+	} else if (at(net) != queue::nil) {
+		return &enabled[at(net)].value;
+	} else if (batched[net] >= 0) {
+		return &batch[batched[net]];
+	}
+	return nullptr;
+}
+
+template <typename Q>
+void basic_simulator<Q>::cancel(int net) {
+	if (net < 0 or net >= (int)nets.size()) {
+		return;
+	} else if (at(net) != queue::nil) {
+		enabled.pop(at(net));
+		at(net) = queue::nil;
+	} else if (batched[net] >= 0) {
+		batch[batched[net]].net = -1;
+		batched[net] = -1;
+	}
+}
+
+// The flush() method pushes every transition scheduled since the last flush
+// into the enabled queue with a single push_batch(). This sorts the new events
+// once and resizes the queue at most once rather than doing both for every
+// scheduled transition of a wide fanout.
+template <typename Q>
+void basic_simulator<Q>::flush() {
+	if (batch.empty()) {
+		return;
+	}
+
+	// drop cancelled transitions
+	batch.erase(remove_if(batch.begin(), batch.end(), [](const enabled_event &t) {
+		return t.net < 0;
+	}), batch.end());
+
+	enabled.push_batch(batch.begin(), batch.end(), handles);
+	for (int i = 0; i < (int)batch.size(); i++) {
+		at(batch[i].net) = handles[i];
+		batched[batch[i].net] = -1;
+	}
+	batch.clear();
+}
+
 // The schedule() method adds a new event to the event queue to be processed in the future.
 // 
 // Events in the calendar queue are organized by their scheduled firing time. When an event
 // is scheduled, it will be placed in the queue according to when it should execute. The
-// actual firing time is determined using a Pareto distribution based on the maximum delay.
+// actual firing time is drawn by the simulator's delay_model from the maximum delay.
+// New events are collected into a batch and pushed into the queue by flush().
 // 
 // If an event is already scheduled for the same net:
 // - For vacuous transitions (same value or mutex assumptions): The existing event is updated
@@ -125,49 +455,60 @@ simulator::queue::event* &simulator::at(int net) {
 // @param value The new value to assign
 // @param strength The driving strength
 // @param stable Whether this is a stable transition
-void simulator::schedule(uint64_t delay_max, boolean::cube assume, boolean::cube guard, int net, int value, int strength, bool stable) {
-	if (debug) cout << "scheduling " << export_expression(guard, *base).to_string() << "->" << base->netAt(net) << " " << value << "*" << strength << (stable ? "" : " unstable") << " {" << export_expression(assume, *base).to_string() << "}" << endl;
+template <typename Q>
+void basic_simulator<Q>::schedule(uint64_t delay_max, sparse_cube assume, sparse_cube guard, int net, int value, int strength, bool stable) {
+	if (debug) cout << "scheduling " << export_expression(guard.cube(), *base).to_string() << "->" << base->netAt(net) << " " << value << "*" << strength << (stable ? "" : " unstable") << " {" << export_expression(assume.cube(), *base).to_string() << "}" << endl;
 	if (net >= (int)nets.size()) {
-		nets.resize(net+1, nullptr);
+		nets.resize(net+1, queue::nil);
+		terms.resize(net+1);
+		batched.resize(net+1, -1);
 	}
 	
 	int prev_value = encoding.get(net);
 
-	// Use Pareto distribution for delay variation
-	// Pareto distribution provides a realistic model of circuit timing variations,
-	// with most transitions happening near the minimum delay but with a long tail
-	// to account for process variations and other physical effects
-	uint64_t fire_at = enabled.now + pareto(delay_max, 5.0);
+	// The default Pareto distribution provides a realistic model of circuit
+	// timing variations, with most transitions happening near the minimum delay
+	// but with a long tail to account for process variations and other physical
+	// effects
+	uint64_t fire_at = now + delay.sample(delay_max);
+	PRS_COUNT(counters.scheduled++; counters.bump(counters.net_scheduled, net));
 	
-	if (at(net) == nullptr) {
+	enabled_event *t = pending(net);
+	enabled_terms &tm = terms[net];
+	if (t == nullptr) {
 		// No existing event for this net - create a new one
-		at(net) = enabled.push(enabled_transition(fire_at, assume, guard, net, value, strength, stable));
-	} else if (at(net)->value.strength == 0 or at(net)->value.value == prev_value or are_mutex(global.xoutnulls(), at(net)->value.assume)) {
+		batched[net] = (int)batch.size();
+		batch.push_back(enabled_event(fire_at, net, value, strength, stable));
+		tm.assume = std::move(assume);
+		tm.guard = std::move(guard);
+	} else if (t->strength == 0 or t->value == prev_value or tm.assume.conflicts(global)) {
 		// It was a vacuous transition (doesn't cause actual change), so replace it
-		at(net)->value.assume = assume;
-		at(net)->value.guard = guard;
-		at(net)->value.value = value;
-		at(net)->value.strength = strength;
-		at(net)->value.stable = stable;
+		PRS_COUNT(counters.vacuous++);
+		tm.assume = std::move(assume);
+		tm.guard = std::move(guard);
+		t->value = value;
+		t->strength = strength;
+		t->stable = stable;
 	} else {
 		// TODO(edward.bingham) maybe schedule a new time it fire_at is sooner than the previous event?
 		//enabled.set(devs[dev], enabled_transition(dev, ((devs[dev]->value+1)&(value+1))-1, fire_at));
 
 		// This is where we handle potential instability when multiple drivers affect the same net
 		// Combine guards and assumptions with existing event
-		at(net)->value.guard &= guard;
-		at(net)->value.assume &= assume;
+		PRS_COUNT(counters.interfering++);
+		tm.guard &= guard;
+		tm.assume &= assume;
 
 		// When values conflict, set to -1 (interference) and mark as unstable
 		// This represents X in traditional HDLs
-		if (value != at(net)->value.value) {
-			at(net)->value.value = -1;  // -1 indicates interference/instability
-			at(net)->value.stable = false;
+		if (value != t->value) {
+			t->value = -1;  // -1 indicates interference/instability
+			t->stable = false;
 		}
 
 		// Take the stronger of the two driving strengths
-		if (at(net)->value.strength < strength) {
-			at(net)->value.strength = strength;
+		if (t->strength < strength) {
+			t->strength = strength;
 		}
 	}
 }
@@ -179,14 +520,15 @@ void simulator::schedule(uint64_t delay_max, boolean::cube assume, boolean::cube
 // @param q Queue of nets to be evaluated
 // @param net The net whose changes are being propagated
 // @param vacuous Whether this is a vacuous transition (no actual value change)
-void simulator::propagate(deque<int> &q, int net, bool vacuous) {
+template <typename Q>
+void basic_simulator<Q>::propagate(worklist &q, int net, bool vacuous) {
 	// First, propagate through transistors where this net is a source terminal
 	for (int driver = 0; driver < 2; driver++) {
-		for (auto i = base->nets[net].sourceOf[driver].begin(); i != base->nets[net].sourceOf[driver].end(); i++) {
-			auto dev = base->devs.begin()+*i;
+		for (int i : flat->sourceOf(net, driver)) {
+			const flat_device *dev = &flat->devs[i];
 			int local_value = encoding.get(dev->gate);
-			if (local_value == 2 or local_value == dev->threshold) {
-				q.push_back(dev->drain);
+			if ((local_value == 2 or local_value == dev->threshold) and (owned.empty() or owned[dev->drain])) {
+				q.push(dev->drain);
 			}
 		}
 	}
@@ -197,7 +539,7 @@ void simulator::propagate(deque<int> &q, int net, bool vacuous) {
 			auto dev = base->devs.begin()+*i;
 			int local_value = encoding.get(dev->gate);
 			if (local_value == 2 or local_value == dev->threshold) {
-				q.push_back(dev->drain);
+				q.push(dev->drain);
 			}
 		}
 	}*/
@@ -205,75 +547,81 @@ void simulator::propagate(deque<int> &q, int net, bool vacuous) {
 	// For non-vacuous changes, also propagate through gates controlled by this net
 	// This handles the case where this net controls other transistors as their gate
 	for (int threshold = 0; threshold < 2 and not vacuous; threshold++) {
-		for (auto i = base->nets[net].gateOf[threshold].begin(); i != base->nets[net].gateOf[threshold].end(); i++) {
-			q.push_back(base->devs[*i].drain);
+		for (int i : flat->gateOf(net, threshold)) {
+			if (owned.empty() or owned[flat->devs[i].drain]) {
+				q.push(flat->devs[i].drain);
+			}
 		}
 	}
 
-	// TODO(edward.bingham) before deleting the variable space, this put an
-	// implicit ordering on the evaluation of net propagation that evaluated
-	// nodes (uid < 0) before nets (uid >= 0). However, after deleting the
-	// variable space, nodes and nets are all mixed together and so this implicit
-	// evaluation constraint no longer holds. This exposes a bug that existed in
-	// the simulator where transient interference or floating values would create
-	// scheduled unstable events in conflict with the isochronic fork assumption
-	// inherent in cmos logic.
-
-	// The proper way to fix this would be to accumulate up the events to
-	// schedule during propagation, overwriting events earlier in the
-	// propagation, then schedule them as a batch. This will create a lot of
-	// churn, and therefore slow down the simulator. I should also make the
-	// node/net ordering explicit to get that speedup back.
-	
-	// Sort and deduplicate the queue to avoid evaluating the same net multiple times
-	sort(q.begin(), q.end(), [this](int a, int b) -> bool {
-		return (base->nets[a].isNode() and not base->nets[b].isNode())
-			or (base->nets[a].isNode() == base->nets[b].isNode() and a < b);
-	});
-	q.erase(unique(q.begin(), q.end()), q.end());
+	// Before deleting the variable space, there was an implicit ordering on
+	// the evaluation of net propagation that evaluated nodes (uid < 0) before
+	// nets (uid >= 0). After deleting the variable space, nodes and nets are
+	// all mixed together, which exposed a bug where transient interference or
+	// floating values would create scheduled unstable events in conflict with
+	// the isochronic fork assumption inherent in cmos logic. The worklist
+	// makes that ordering explicit, precomputed once per circuit, and
+	// deduplicates nets as they are pushed instead of sorting the queue after
+	// every propagation.
 }
 
-void simulator::model(int i, bool reverse, boolean::cube &assume, boolean::cube &guard, int &value, int &drive_strength, int &glitch_value, int &glitch_strength, uint64_t &delay_max) {
-	auto dev = base->devs.begin()+i;
+template <typename Q>
+void basic_simulator<Q>::model(int i, bool reverse, sparse_cube &assume, sparse_cube &guard, int &value, int &drive_strength, int &glitch_value, int &glitch_strength, uint64_t &delay_max) {
+	const flat_device *dev = &flat->devs[i];
+	PRS_COUNT(counters.bump(counters.dev_modeled, i));
 	
 	// Check if this device's assumptions conflict with the current state
-	// If they conflict, this device is disabled by its assumptions
-	bool fail_assumption = are_mutex(global.xoutnulls(), dev->attr.assume);
-	if (debug and fail_assumption) {
-		cout << "\tfailed assumption " << export_composition(global, *base).to_string() << " & " << export_expression(dev->attr.assume, *base).to_string() << endl;
-	}
-	
-	// Apply assumptions to the observed state
-	boolean::cube observed = encoding;
-	boolean::cube assume_action;
-	if (not fail_assumption) {
-		// Collect all compatible assumptions
-		for (auto c = dev->attr.assume.cubes.begin(); c != dev->attr.assume.cubes.end(); c++) {
-			if (not are_mutex(encoding.xoutnulls(), *c)) {
-				assume_action &= *c;
+	// If they conflict, this device is disabled by its assumptions. The
+	// assumption is compiled into sparse cubes, which are checked against the
+	// state in place rather than against dense copies with the nulls removed.
+	bool fail_assumption = false;
+	sparse_cube assume_action;
+	if (dev->assumes) {
+		const vector<sparse_cube> &dev_assume = flat->assume[i];
+		fail_assumption = true;
+		for (auto c = dev_assume.begin(); c != dev_assume.end() and fail_assumption; c++) {
+			fail_assumption = c->conflicts(global);
+		}
+		if (debug and fail_assumption) {
+			cout << "\tfailed assumption " << export_composition(global, *base).to_string() << " & " << export_expression(base->devs[i].attr.assume, *base).to_string() << endl;
+		}
+
+		if (not fail_assumption) {
+			// Collect all compatible assumptions
+			for (auto c = dev_assume.begin(); c != dev_assume.end(); c++) {
+				if (not c->conflicts(encoding)) {
+					assume_action &= *c;
+				}
 			}
+			assume_action = assume_action.xoutnulls();
 		}
-		assume_action = assume_action.xoutnulls();
-		observed &= assume_action;
 	}
 
+	// Apply assumptions to the observed state, only reading the nets this
+	// device touches rather than copying the whole encoding
+	auto observed = [&](int net) {
+		int val = encoding.get(net);
+		int assumed = assume_action.get(net);
+		return assumed == 2 ? val : ((val+1)&(assumed+1))-1;
+	};
+
 	// Handle both normal and reverse direction operations
 	// (reverse is for bidirectional devices)
 	int source = reverse ? dev->drain : dev->source;
 	int drain = reverse ? dev->source : dev->drain;
 
-	int prev_value = observed.get(drain)+1;
+	int prev_value = observed(drain)+1;
 	int prev_strength = 2-strength.get(drain);
 
 	//bool isremote = net != drain;
 
 	// Get gate value (controls whether device is on or off)
-	int local_value = observed.get(dev->gate);
+	int local_value = observed(dev->gate);
 	int global_value = global.get(dev->gate);
 
 	// Calculate source value and strength
 	// The "+1" adjustment handles our internal representation of X as -1
-	int source_value = observed.get(source)+1;
+	int source_value = observed(source)+1;
 	int source_strength = 2-strength.get(source);
 	
 	// Complex strength adjustment logic based on circuit conditions
@@ -291,10 +639,10 @@ void simulator::model(int i, bool reverse, boolean::cube &assume, boolean::cube
 			// Reduce strength for backflow
 			source_strength = 1;
 		}
-	} else if (dev->attr.force and source_strength > 2) {
+	} else if (dev->force and source_strength > 2) {
 		// Force attribute means use power driving
 		source_strength = 3;
-	} else if (dev->attr.weak and source_strength > 1) {
+	} else if (dev->weak and source_strength > 1) {
 		// Weak attribute means use weak driving
 		source_strength = 1;
 	} else if (source_strength > 2) {
@@ -316,8 +664,8 @@ void simulator::model(int i, bool reverse, boolean::cube &assume, boolean::cube
 			// device is driving net stronger than other devices - take over
 			value = source_value;
 			drive_strength = source_strength;
-			if (dev->attr.delay_max < delay_max) {
-				delay_max = dev->attr.delay_max;
+			if (dev->delay_max < delay_max) {
+				delay_max = dev->delay_max;
 			} else {
 				// TODO(edward.bingham) weak instability?
 			}
@@ -327,14 +675,14 @@ void simulator::model(int i, bool reverse, boolean::cube &assume, boolean::cube
 			// This operation works because of how values are encoded:
 			// When two equal-strength drivers conflict, result is interference (X)
 			value &= source_value;
-			if (dev->attr.delay_max < delay_max) {
-				delay_max = dev->attr.delay_max;
+			if (dev->delay_max < delay_max) {
+				delay_max = dev->delay_max;
 			}
 			// TODO(edward.bingham) this might also cause instability
 			if (debug) cout << "\tdriven " << (value-1) << "*" << drive_strength << endl;
 		}
 		if (not fail_assumption and global_value != 2 and global_value != -1) {
-			if (debug) cout << "\tassume {" << export_expression(assume_action, *base).to_string() << "}" << endl;
+			if (debug) cout << "\tassume {" << export_expression(assume_action.cube(), *base).to_string() << "}" << endl;
 			guard.set(dev->gate, global_value);
 			assume &= assume_action;
 		}
@@ -347,14 +695,14 @@ void simulator::model(int i, bool reverse, boolean::cube &assume, boolean::cube
 		if (source_strength > glitch_strength) {
 			glitch_value = source_value;
 			glitch_strength = source_strength;
-			if (dev->attr.delay_max < delay_max) {
-				delay_max = dev->attr.delay_max;
+			if (dev->delay_max < delay_max) {
+				delay_max = dev->delay_max;
 			}
 			if (debug) cout << "\tstronger glitch " << (glitch_value-1) << "*" << glitch_strength  << endl;
 		} else if (source_strength == glitch_strength) {
 			glitch_value &= source_value;
-			if (dev->attr.delay_max < delay_max) {
-				delay_max = dev->attr.delay_max;
+			if (dev->delay_max < delay_max) {
+				delay_max = dev->delay_max;
 			}
 			if (debug) cout << "\tglitch " << (glitch_value-1) << "*" << glitch_strength << endl;
 		} else {
@@ -373,29 +721,44 @@ void simulator::model(int i, bool reverse, boolean::cube &assume, boolean::cube
 // immediate logical consequences of the current state.
 // 
 // @param nets A collection of nets to evaluate changes on
-void simulator::evaluate(deque<int> nets) {
-	deque<int> q = nets;
-	boolean::cube ack;
-	while (not q.empty()) {
-		int net = q.front();
-		q.pop_front();
+template <typename Q>
+void basic_simulator<Q>::evaluate(const deque<int> &nets) {
+	for (auto i = nets.begin(); i != nets.end(); i++) {
+		dirty.push(*i);
+	}
+	evaluate();
+}
+
+// Evaluate the nets waiting in dirty, lowest rank first
+template <typename Q>
+void basic_simulator<Q>::evaluate() {
+	PRS_COUNT(if (not dirty.empty()) {
+		counters.evaluations++;
+		counters.worklist_total += dirty.count;
+		counters.worklist_max = std::max(counters.worklist_max, (uint64_t)dirty.count);
+	});
+
+	sparse_cube ack;
+	while (not dirty.empty()) {
+		int net = dirty.pop();
+		PRS_COUNT(counters.bump(counters.net_evaluated, net));
 
 		int glitch_value = 3;
 		int glitch_strength = 0;
 		int drive_strength = 0;
 		int value = 3;
-		if (base->nets[net].keep) {
+		if (flat->nets[net].keep) {
 			drive_strength = 1;
 			value = encoding.get(net)+1;
 		}
-		boolean::cube guard;
-		boolean::cube assumed;
+		sparse_cube guard;
+		sparse_cube assumed;
 		uint64_t delay_max = std::numeric_limits<uint64_t>::max();
 
 		if (debug) cout << "evaluating " << net << "/(" << base->nets.size() << ") " << base->netAt(net) << ":" << encoding.get(net) << (base->nets[net].keep ? " keep" : "") << endl;
 		for (int driver = 0; driver < 2; driver++) {
-			for (auto i = base->nets[net].drainOf[driver].begin(); i != base->nets[net].drainOf[driver].end(); i++) {
-				model(*i, false, assumed, guard, value, drive_strength, glitch_value, glitch_strength, delay_max);
+			for (int i : flat->drainOf(net, driver)) {
+				model(i, false, assumed, guard, value, drive_strength, glitch_value, glitch_strength, delay_max);
 			}
 
 			/*for (auto i = base->nets[net].rsourceOf[driver].begin(); i != base->nets[net].rsourceOf[driver].end(); i++) {
@@ -431,25 +794,30 @@ void simulator::evaluate(deque<int> nets) {
 		if (debug) cout << value << " strength = " << drive_strength << endl;
 
 		// TODO(edward.bingham) we should only propagate instantly here if delay_max is 0, we need to handle the other condition in the import/export of production rules, not in the simulator
-		if (delay_max == 0 or (base->nets[net].gateOf[0].empty() and base->nets[net].gateOf[1].empty() and (not base->nets[net].sourceOf[0].empty() or not base->nets[net].sourceOf[1].empty()))) {
+		if (delay_max == 0 or (not flat->nets[net].gated and flat->nets[net].sourced)) {
 			if (value >= 0) {
-				ack &= guard & assumed;
+				ack &= guard;
+				ack &= assumed;
 				assume(assumed);
 			}
 
 			int avalue = assumed.get(net);
 			if (avalue == 2 or avalue != 1-value) {
-				set(net, value, drive_strength, stable, &q);
+				set(net, value, drive_strength, stable, &dirty);
 			}
 		} else {
 			int avalue = assumed.get(net);
 			if (avalue == 2 or avalue != 1-value) {
-				schedule(delay_max, assumed, guard, net, value, drive_strength, stable);
+				schedule(delay_max, std::move(assumed), std::move(guard), net, value, drive_strength, stable);
 			}
 		}
 	}
 
-	encoding = encoding & ack;
+	flush();
+	encoding &= ack;
+	for (auto l = ack.begin(); l != ack.end(); l++) {
+		touch(l->var);
+	}
 }
 
 // The fire() method is the core mechanism for advancing simulation time and processing events.
@@ -471,40 +839,90 @@ void simulator::evaluate(deque<int> nets) {
 // 
 // @param net The index of the net whose event should be fired, or std::numeric_limits<int>::max() to fire the next event chronologically
 // @return The transition that was fired
-enabled_transition simulator::fire(int net) {
-	enabled_transition t;
+template <typename Q>
+enabled_transition basic_simulator<Q>::fire(int net) {
+	enabled_event e;
 	if (net == std::numeric_limits<int>::max()) {
-		t = enabled.pop();
+		e = enabled.pop();
+		now = enabled.now;
 	} else if (net < 0 or net >= (int)nets.size()) {
 		printf("error: attempting to fire transition on non-existent net\n");
-		return t;
-	} else if (nets[net] == nullptr) {
+		return enabled_transition();
+	} else if (nets[net] == queue::nil) {
 		printf("error: no transition to fire on this net\n");
-		return t;
+		return enabled_transition();
 	} else {
-		t = enabled.pop(at(net));
-		at(net) = nullptr;
+		e = enabled.pop(at(net));
+		at(net) = queue::nil;
 	}
 
-	if (t.net < 0 or t.net >= (int)nets.size()) {
+	if (e.net < 0 or e.net >= (int)nets.size()) {
 		printf("error: attempting to fire non-existent transition\n");
-		return t;
+		return enabled_transition(e.fire_at, sparse_cube(), sparse_cube(), e.net, e.value, e.strength, e.stable);
 	}
 
-	at(t.net) = nullptr;
-	
+	at(e.net) = queue::nil;
+
+	// The terms are no longer needed once the event has fired, so move them
+	// into the fired transition rather than copying them
+	enabled_transition t(e.fire_at, std::move(terms[e.net].assume), std::move(terms[e.net].guard), e.net, e.value, e.strength, e.stable);
+	commit(e, t.assume, t.guard);
+	return t;
+}
+
+// Apply an event that was just taken from the queue. Its guard and
+// assumptions are acknowledged into encoding, events that contradict its
+// assumptions are cancelled, and its value is set on its net. assume and
+// guard may be the net's own entry in terms, since nothing here writes to it
+// before the set(), which may schedule a new event on the net.
+template <typename Q>
+void basic_simulator<Q>::commit(const enabled_event &e, const sparse_cube &assume, const sparse_cube &guard) {
 	if (debug) {
-		printf("firing %s->%s%c:%d%s {%s}\n", export_expression(t.guard, *base).to_string().c_str(), base->netAt(t.net).c_str(), t.value == 0 ? '-' : (t.value == 1 ? '+' : '~'), t.strength, t.stable ? "" : " unstable", export_expression(t.assume, *base).to_string().c_str());
+		printf("firing %s->%s%c:%d%s {%s}\n", export_expression(guard.cube(), *base).to_string().c_str(), base->netAt(e.net).c_str(), e.value == 0 ? '-' : (e.value == 1 ? '+' : '~'), (int)e.strength, e.stable ? "" : " unstable", export_expression(assume.cube(), *base).to_string().c_str());
 	}
 
-	if (t.value >= 0) {
-		encoding &= t.guard & t.assume;
-		assume(t.assume);
+	if (e.value >= 0) {
+		encoding &= guard;
+		encoding &= assume;
+		for (auto l = guard.begin(); l != guard.end(); l++) {
+			touch(l->var);
+		}
+		for (auto l = assume.begin(); l != assume.end(); l++) {
+			touch(l->var);
+		}
+		this->assume(assume);
 	}
 
-	deque<int> q;
-	set(t.net, t.value, t.strength, t.stable);
-	return t;
+	set(e.net, e.value, e.strength, e.stable);
+
+	PRS_COUNT(
+		counters.fired++;
+		counters.bump(counters.net_fired, e.net);
+		if constexpr (requires (Q q) { q.grows; }) {
+			counters.grows = enabled.grows;
+			counters.shrinks = enabled.shrinks;
+			counters.retunes = enabled.retunes;
+		}
+	);
+}
+
+// Watching a net past the end of watched grows it
+template <typename Q>
+void basic_simulator<Q>::watch(int net, bool on) {
+	if (net >= (int)watched.size()) {
+		if (not on) {
+			return;
+		}
+		watched.resize(net+1, false);
+	}
+	watched[net] = on;
+}
+
+template <typename Q>
+run_result basic_simulator<Q>::run_until(uint64_t until, uint64_t events) {
+	return run_until(until, events, [](const enabled_event &e) {
+		return false;
+	});
 }
 
 // The assume() method applies assumptions about signal values to the simulation.
@@ -522,16 +940,19 @@ enabled_transition simulator::fire(int net) {
 // but won't change a's current value if it's already 1.
 // 
 // @param assume Boolean cube representing the assumed signal values
-void simulator::assume(boolean::cube assume) {
-	for (int net = 0; net < (int)assume.values.size()*16; net++) {
-		int value = assume.get(net);
-		if (value != 2 and net < (int)nets.size()) {
-			auto e = at(net);
-			if (e != nullptr and (e->value.value != value or not e->value.stable)) {
-				if (debug) printf("popping event %d\n", net);
-				enabled.pop(e);
-				at(net) = nullptr;
-			}
+template <typename Q>
+void basic_simulator<Q>::assume(const boolean::cube &assume) {
+	this->assume(sparse_cube(assume));
+}
+
+template <typename Q>
+void basic_simulator<Q>::assume(const sparse_cube &assume) {
+	for (auto l = assume.begin(); l != assume.end(); l++) {
+		enabled_event *t = pending(l->var);
+		if (t != nullptr and (t->value != l->val or not t->stable)) {
+			if (debug) printf("popping event %d\n", l->var);
+			PRS_COUNT(counters.cancelled++);
+			cancel(l->var);
 		}
 	}
 }
@@ -560,7 +981,8 @@ void simulator::assume(boolean::cube assume) {
 // @param stable Whether this is a stable value
 // @param q Optional queue to add this net to for later evaluation. If nullptr,
 // then evaluation is automatically handled.
-void simulator::set(int net, int value, int strength, bool stable, deque<int> *q) {
+template <typename Q>
+void basic_simulator<Q>::set(int net, int value, int strength, bool stable, worklist *q) {
 	// Check constraints and report errors if violated
 	if (base->require_stable and not stable and strength > 0) {
 		error("", "unstable rule " + base->netAt(net) + (value == 1 ? "+" : (value == 0 ? "-" : "~")), __FILE__, __LINE__);
@@ -573,10 +995,7 @@ void simulator::set(int net, int value, int strength, bool stable, deque<int> *q
 	}
 
 	// Cancel any pending events for this net
-	if (net >= 0 and net < (int)nets.size() and at(net) != nullptr) {
-		enabled.pop(at(net));
-		at(net) = nullptr;
-	}
+	cancel(net);
 
 	int prev_value = encoding.get(net);
 	int prev_strength = 2-this->strength.get(net);
@@ -595,15 +1014,15 @@ void simulator::set(int net, int value, int strength, bool stable, deque<int> *q
 	// These occur when a controlling gate changes while source and drain differ
 	if (base->require_adiabatic and not vacuous and (value == 0 or value == 1)) {
 		vector<int> viol;
-		for (auto i = base->nets[net].gateOf[value].begin(); i != base->nets[net].gateOf[value].end(); i++) {
-			int drain_value = encoding.get(base->devs[*i].drain);
-			int source_value = encoding.get(base->devs[*i].source);
+		for (int i : flat->gateOf(net, value)) {
+			int drain_value = encoding.get(flat->devs[i].drain);
+			int source_value = encoding.get(flat->devs[i].source);
 			// Non-adiabatic condition: gate changes while source and drain differ
 			// This can cause energy inefficiency and glitches in physical circuits
-			if ((not base->assume_nobackflow or source_value == base->devs[*i].driver)
+			if ((not base->assume_nobackflow or source_value == flat->devs[i].driver)
 				and drain_value != source_value) {
-				//printf("assume_nobackflow %d source_value %d driver %d drain_value %d value %d threshold %d\n", (int)base->assume_nobackflow, source_value, base->devs[*i].driver, drain_value, value, base->devs[*i].threshold);
-				viol.push_back(*i);
+				//printf("assume_nobackflow %d source_value %d driver %d drain_value %d value %d threshold %d\n", (int)base->assume_nobackflow, source_value, flat->devs[i].driver, drain_value, value, flat->devs[i].threshold);
+				viol.push_back(i);
 			}
 		}
 		if (not viol.empty()) {
@@ -623,35 +1042,51 @@ void simulator::set(int net, int value, int strength, bool stable, deque<int> *q
 		}
 	}
 
+	if (net < (int)exported.size() and exported[net]) {
+		outbox.push_back(enabled_event(now, net, value, strength, stable));
+	}
+
 	// Apply the value changes to the circuit state
+	touch(net);
 	encoding.set(net, value);
 	global.set(net, value);
 	this->strength.set(net, 2-strength);
 	
 	// Handle remote nets (connected signals that mirror this net's value)
-	for (auto i = base->nets[net].remote.begin(); i != base->nets[net].remote.end(); i++) {
-		if (*i == net) {
+	for (int i : flat->remote(net)) {
+		if (tracer != nullptr) {
+			tracer->record(now, i, value, strength, stable);
+		}
+		if (i == net) {
 			continue;
 		}
-		encoding.remote_set(*i, value, stable);
-		global.set(*i, value);
-		this->strength.set(*i, 2-strength);
+		touch(i);
+		encoding.remote_set(i, value, stable);
+		global.set(i, value);
+		this->strength.set(i, 2-strength);
+	}
+
+	// Only a change in value can break a property
+	if (checker != nullptr and not vacuous) {
+		for (int i : flat->remote(net)) {
+			checker->check(encoding, i, now);
+		}
 	}
 
-	// Set up queue for propagation
-	deque<int> tmp;
+	// Without a caller's worklist, collect the affected nets in dirty and
+	// evaluate them here
 	bool doEval = false;
 	if (q == nullptr) {
-		q = &tmp;
+		q = &dirty;
 		doEval = true;
 	}
 
 	// Propagate changes through the circuit
-	for (auto i = base->nets[net].remote.begin(); i != base->nets[net].remote.end(); i++) {
-		propagate(*q, *i, vacuous);
+	for (int i : flat->remote(net)) {
+		propagate(*q, i, vacuous);
 	}
 	if (doEval and not q->empty()) {
-		evaluate(*q);
+		evaluate();
 	}
 }
 
@@ -665,18 +1100,34 @@ void simulator::set(int net, int value, int strength, bool stable, deque<int> *q
 // @param strength The driving strength
 // @param stable Whether these are stable values
 // @param q Optional queue to add affected nets to for later evaluation
-void simulator::set(boolean::cube action, int strength, bool stable, deque<int> *q) {
+template <typename Q>
+void basic_simulator<Q>::set(boolean::cube action, int strength, bool stable, worklist *q) {
 	// Calculate the remote actions (effects on connected nets)
-	// Remote groups are collections of nets that are electrically connected
-	boolean::cube remote_action = action.remote(base->remote_groups());
+	// Remote groups are collections of nets that are electrically connected,
+	// read from the compiled netlist rather than recomputed for every call
+	boolean::cube remote_action = action;
+	for_each_literal(action, [&](int net, int val) {
+		if (net >= flat->size()) {
+			return;
+		}
+		for (int r : flat->remote(net)) {
+			remote_action.set(r, ((remote_action.get(r)+1)&(val+1))-1);
+		}
+	});
 	
 	// Cancel any pending events on affected nets
-	for (int net = 0; net < action.size()*16; net++) {
-		int val = action.get(net);
-		if (val != 2 and net >= 0 and net < (int)nets.size() and at(net) != nullptr) {
-			enabled.pop(at(net));
-			at(net) = nullptr;
-		}
+	for_each_literal(action, [this](int net, int val) {
+		cancel(net);
+	});
+
+	// The nets whose value changes, to check against the assertions
+	vector<int> flipped;
+	if (checker != nullptr) {
+		for_each_literal(remote_action, [&](int net, int val) {
+			if (encoding.get(net) != val) {
+				flipped.push_back(net);
+			}
+		});
 	}
 
 	// Apply the boolean cube operations to update circuit state
@@ -686,23 +1137,30 @@ void simulator::set(boolean::cube action, int strength, bool stable, deque<int>
 	global = local_assign(global, remote_action, true);
 	encoding = remote_assign(local_assign(encoding, action, true), global, true);
 	this->strength &= remote_action.mask().flip();
+	touch();
+	if (tracer != nullptr) {
+		for_each_literal(remote_action, [&](int net, int val) {
+			tracer->record(now, net, val, strength, stable);
+		});
+	}
+	for (int net : flipped) {
+		checker->check(encoding, net, now);
+	}
 
-	// Set up queue for propagation
-	deque<int> tmp;
+	// Without a caller's worklist, collect the affected nets in dirty and
+	// evaluate them here
 	bool doEval = false;
 	if (q == nullptr) {
-		q = &tmp;
+		q = &dirty;
 		doEval = true;
 	}
 
 	// Propagate changes through the circuit
-	for (int net = 0; net < remote_action.size()*16; net++) {
-		if (remote_action.get(net) != 2) {
-			propagate(*q, net, false);
-		}
-	}
+	for_each_literal(remote_action, [&](int net, int val) {
+		propagate(*q, net, false);
+	});
 	if (doEval and not q->empty()) {
-		evaluate(*q);
+		evaluate();
 	}
 }
 
@@ -718,10 +1176,23 @@ void simulator::set(boolean::cube action, int strength, bool stable, deque<int>
 // This should be called before beginning a new simulation run to ensure
 // a clean initial state. After reset(), the circuit will be in its reset state
 // (if it has one defined).
-void simulator::reset()
+template <typename Q>
+void basic_simulator<Q>::reset()
 {
+	if (not flat->matches(*base)) {
+		flat = std::make_shared<const flat_netlist>(*base);
+	}
+	dirty.reorder(base);
 	enabled.clear();
+	now = enabled.now;
+	delay.reseed();
 	nets.clear();
+	terms.clear();
+	batch.clear();
+	batched.clear();
+	last = simulator_state();
+	touched.clear();
+	changed.clear();
 	global.values.clear();
 	encoding.values.clear();
 	strength.values.clear();
@@ -760,19 +1231,18 @@ void simulator::reset()
 // 
 // The method uses a relatively long delay (10000 time units) to ensure
 // any shorter events complete first.
-void simulator::wait()
+template <typename Q>
+void basic_simulator<Q>::wait()
 {
-	// Get remote groups (electrically connected nets)
-	vector<vector<int> > groups = base->remote_groups();
-	
 	// Schedule events to make encoding converge to global for any mismatches
 	// Uses a long delay (10000) to ensure these happen after shorter events
 	for (int net = 0; net < (int)global.values.size()*16; net++) {
 		int value = global.get(net);
-		if (encoding.get(net) != value) {
-			schedule(10000, 1, 1, net, value, 2, true);
+		if (encoding.get(net) != value and (owned.empty() or (net < (int)owned.size() and owned[net]))) {
+			schedule(10000, sparse_cube(), sparse_cube(), net, value, 2, true);
 		}
 	}
+	flush();
 }
 
 // The run() method deasserts reset signals to allow the circuit to begin normal operation.
@@ -783,7 +1253,8 @@ void simulator::wait()
 // 
 // After calling run(), you should repeatedly call fire() until all events
 // are processed to simulate the circuit's behavior.
-void simulator::run()
+template <typename Q>
+void basic_simulator<Q>::run()
 {
 	for (int i = 0; i < (int)base->nets.size(); i++) {
 		if (base->netAt(i) == "Reset") {
@@ -794,4 +1265,7 @@ void simulator::run()
 	}
 }
 
+template struct basic_simulator<calendar_backend>;
+template struct basic_simulator<radix_backend>;
+
 }
@@ -1,22 +1,33 @@
 #pragma once
 
 #include "calendar_queue.h"
+#include "radix_heap.h"
 #include "production_rule.h"
+#include "sparse_cube.h"
+#include "flat_netlist.h"
+#include "delay_model.h"
+#include "trace.h"
+#include "counters.h"
+#include "assertion.h"
 #include <common/standard.h>
 
+#include <memory>
+
 namespace prs {
 
 // Represents a scheduled transition/event in the simulation
 // An enabled transition contains all information about an event that will occur at a specific time
+// The queue itself stores the compact enabled_event below, and fire() reassembles the full
+// transition from it when the event fires
 struct enabled_transition {
 	enabled_transition();
-	enabled_transition(uint64_t fire_at, boolean::cube assume, boolean::cube guard, int net, int value, int strength, bool stable);
+	enabled_transition(uint64_t fire_at, sparse_cube assume, sparse_cube guard, int net, int value, int strength, bool stable);
 	~enabled_transition();
 
 	uint64_t fire_at;  // Time at which this transition should fire
 
-	boolean::cube assume;  // Conditions that must be true for this transition to happen
-	boolean::cube guard;   // Guard condition that activates this transition
+	sparse_cube assume;  // Conditions that must be true for this transition to happen
+	sparse_cube guard;   // Guard condition that activates this transition
 	int net;              // The net (signal) this transition affects
 	int value;            // New value: 1=high, 0=low, -1=unstable/interference
 	int strength;         // Signal strength: 0=floating, 1=weak, 2=normal, 3=power
@@ -25,17 +36,135 @@ struct enabled_transition {
 	string to_string(const production_rule_set *base);
 };
 
+bool operator<(const enabled_transition &t0, const enabled_transition &t1);
+bool operator>(const enabled_transition &t0, const enabled_transition &t1);
+
+// The compact record of a scheduled transition that is stored in the event
+// queue. Its guard and assumptions live in simulator::terms, indexed by net,
+// so pushing, popping, and resizing the queue never copies a cube.
+struct enabled_event {
+	enabled_event();
+	enabled_event(uint64_t fire_at, int net, int value, int strength, bool stable);
+	~enabled_event();
+
+	uint64_t fire_at;  // Time at which this transition should fire
+	int net;           // The net (signal) this transition affects
+	int8_t value;      // New value: 1=high, 0=low, -1=unstable/interference
+	int8_t strength;   // Signal strength: 0=floating, 1=weak, 2=normal, 3=power
+	bool stable;       // Whether this transition produces a stable value
+};
+
+// Why basic_simulator::run_until() returned, and how far it got
+struct run_result {
+	run_result();
+	~run_result();
+
+	enum {
+		drained = 0,  // no events are left
+		time = 1,     // the next event is after the time limit
+		events = 2,   // the limit on the number of events was reached
+		watched = 3,  // an event fired on a watched net
+		stopped = 4   // the stop condition returned true
+	};
+
+	int reason;
+	uint64_t fired;  // events fired
+	int net;         // net of the last event fired, -1 if none
+};
+
+// Guard and assumptions of the pending transition on a net
+struct enabled_terms {
+	sparse_cube assume;
+	sparse_cube guard;
+};
+
+// The saved state of a block of simulator_state::width consecutive nets:
+// their words of encoding, global, and strength, and their pending events
+// with the guards and assumptions of those events. A chunk is never modified
+// once it is saved, so snapshots share the chunks that did not change
+// between them.
+struct state_chunk {
+	state_chunk();
+	~state_chunk();
+
+	// encoding, global, and strength
+	vector<unsigned int> values[3];
+	vector<enabled_event> events;
+	vector<enabled_terms> terms;
+};
+
+// A snapshot of a simulator taken by snapshot() and returned to with
+// restore(). Copying one copies only the chunk pointers, so a depth first
+// search can keep a snapshot at every branch point. The circuit, the
+// partition set by region_simulator, and the outbox are not part of it.
+struct simulator_state {
+	simulator_state();
+	~simulator_state();
+
+	// nets per chunk, a multiple of the 16 nets in a word of a cube
+	static const int width = 256;
+
+	vector<std::shared_ptr<const state_chunk> > chunks;
+	// number of words in encoding, global, and strength
+	int size[3];
+	uint64_t now;
+	xoshiro256 rng;
+};
+
 struct enabled_priority {
-	uint64_t operator()(const enabled_transition &value) {
+	uint64_t operator()(const enabled_event &value) {
 		return value.fire_at;
 	}
+
+	// Events at the same time fire in order of net, so the order does not
+	// depend on the order in which they were scheduled
+	uint64_t tie(const enabled_event &value) {
+		return (uint64_t)value.net;
+	}
 };
 
-bool operator<(enabled_transition t0, enabled_transition t1);
-bool operator>(enabled_transition t0, enabled_transition t1);
+// The set of nets waiting for evaluate(). Nets are evaluated in a fixed
+// order, nodes before named nets and each group by index, so that internal
+// nodes settle before the nets they drive. That order is computed once per
+// circuit and each net is identified by its rank within it, so a push is a
+// bit set that also deduplicates, and a pop finds the lowest marked rank.
+struct worklist {
+	worklist();
+	~worklist();
+
+	const production_rule_set *base;
+
+	vector<int> order;  // net at each rank
+	vector<int> rank;   // rank of each net
+
+	day_bitmap waiting;
+	uint64_t first;     // no waiting net has a rank below first
+	int count;
+
+	// recompute the evaluation order for base
+	void reorder(const production_rule_set *base);
+	// evaluate the nets of base in the given order, which must list every net
+	void reorder(const production_rule_set *base, const vector<int> &order);
+
+	// rank nets up to n that are not yet in the order after all of the others
+	void extend(int n);
+
+	void push(int net);
+	// remove and return the waiting net with the lowest rank
+	int pop();
+	bool empty() const;
+	void clear();
+};
 
 // Core simulation engine for Production Rule Sets (PRS)
 //
+// The simulator is templated on the priority queue Q that holds its enabled
+// transitions. Q must provide the handle type and nil, push(), push_batch(),
+// pop() for the earliest event, pop(handle) to cancel an event, set(handle)
+// to move an event earlier, operator[] to access an event's value, now, and
+// clear(). calendar_queue and radix_heap both qualify, and the simulator and
+// radix_simulator aliases below select between them.
+//
 // The simulator class provides a framework for simulating asynchronous digital circuits
 // represented as Production Rule Sets (PRS). It handles:
 //
@@ -59,17 +188,26 @@ bool operator>(enabled_transition t0, enabled_transition t1);
 // - Strengths: 0=floating, 1=weak, 3=power (strongest)
 // - Events: Scheduled state changes with specific timing
 // - Assumptions: Constraints on signal values that prevent contradicting events
-struct simulator {
-	simulator();
-	simulator(const production_rule_set *base, bool debug=false);
-	~simulator();
+template <typename Q>
+struct basic_simulator {
+	basic_simulator();
+	basic_simulator(const production_rule_set *base, bool debug=false);
+	// Share a flat_netlist already compiled from base, as between the
+	// simulators of a sweep
+	basic_simulator(const production_rule_set *base, std::shared_ptr<const flat_netlist> flat, bool debug=false);
+	~basic_simulator();
 
-	using queue=calendar_queue<enabled_transition, enabled_priority>;
+	using queue=Q;
 
 	bool debug;  // Enable verbose debug output
 
 	const production_rule_set *base;  // The circuit being simulated
 
+	// Compiled copy of the connectivity of base that the evaluation loops
+	// read. It is never modified once built, so copies of a simulator share
+	// it, and reset() only rebuilds it if base changed since.
+	std::shared_ptr<const flat_netlist> flat;
+
 	// Signal value representations:
 	// 2 = undriven or unknown
 	// 1 = stable one (high)
@@ -94,40 +232,151 @@ struct simulator {
 	// Queue of all pending/scheduled events ordered by firing time
 	queue enabled;
 
-	// Array indexed by net ID pointing to events in the enabled queue
-	// Each net can have at most one pending event
-	vector<queue::event*> nets;
+	// Simulation time that new transitions are scheduled from, the firing
+	// time of the last event taken from the front of the queue
+	uint64_t now;
+
+	// Chooses each transition's delay from its delay_max with this
+	// simulator's own generator, Pareto distributed by default. reset()
+	// restarts the generator from delay.seed, so a run is reproducible from
+	// its seed, and delay_model::fixed_max takes exactly delay_max.
+	delay_model delay;
+
+	// Array indexed by net ID of handles to events in the enabled queue
+	// Each net can have at most one pending event, queue::nil if none
+	vector<typename queue::handle> nets;
+
+	// Array indexed by net ID of the guard and assumptions of that net's
+	// pending event, only meaningful while the event is pending
+	vector<enabled_terms> terms;
+
+	// Transitions scheduled since the last flush() that have not yet been
+	// pushed into the enabled queue, and the index into batch for each net
+	// (-1 if none). Cancelled entries have their net set to -1.
+	vector<enabled_event> batch;
+	vector<int> batched;
+	// Handles of the events pushed by the last flush(), kept to reuse its
+	// storage
+	vector<typename queue::handle> handles;
+
+	// Nets waiting to be evaluated, reused across calls to evaluate()
+	worklist dirty;
+
+	// Set by region_simulator to split a circuit across several simulators.
+	// owned marks the nets whose drivers this simulator evaluates, and is
+	// empty to evaluate every net. Changes to nets marked in exported are
+	// also recorded in outbox, stamped with the time of the change, so that
+	// they can be forwarded to the simulators that read them.
+	vector<bool> owned;
+	vector<bool> exported;
+	vector<enabled_event> outbox;
+
+	// What this simulator did, only counted when built with PRS_COUNTERS
+	sim_counters counters;
+
+	// If set, every change to the value or strength of a net, including its
+	// remote copies, is recorded here. The writer is not owned, and a copy
+	// of the simulator shares it, so only one of them may trace at a time.
+	trace_writer *tracer;
+
+	// If set, the properties here that read a net are checked each time its
+	// value changes. Like the tracer it is not owned and copies share it.
+	assertions *checker;
+
+	// Nets that end run_until() once an event fires on them
+	vector<bool> watched;
+
+	// The state as of the last snapshot() or restore(), whose chunks the
+	// next snapshot shares, and the chunks with a net whose value, strength,
+	// or pending event may have changed since, each listed once
+	simulator_state last;
+	vector<bool> touched;
+	vector<int> changed;
+
+	// Access the event scheduled for a specific net. Every change to a
+	// net's pending event goes through here, so this also touches the net.
+	typename queue::handle &at(int net);
+
+	// Mark the chunk of a net as changed since the last snapshot
+	void touch(int net) {
+		int k = net/simulator_state::width;
+		if (k >= (int)touched.size()) {
+			touched.resize(k+1, false);
+		}
+		if (not touched[k]) {
+			touched[k] = true;
+			changed.push_back(k);
+		}
+	}
+	// Mark every chunk as changed
+	void touch();
+
+	// Save the current state, copying only the chunks that changed since
+	// the last snapshot() or restore() and sharing the rest with it
+	simulator_state snapshot();
+	// Return to a snapshot taken from this simulator, rewriting only the
+	// chunks that changed since the last snapshot() or restore() or that
+	// differ between it and s
+	void restore(const simulator_state &s);
+
+	// Configure the queue for the spread of delays the simulator produces
+	void adapt();
+
+	// Access the pending transition for a net whether it is in the enabled
+	// queue or still in the batch, or nullptr if there is none
+	enabled_event *pending(int net);
 
-	// Access the event scheduled for a specific net
-	queue::event* &at(int net);
+	// Cancel the pending transition for a net if there is one
+	void cancel(int net);
+
+	// Push all batched transitions into the enabled queue
+	void flush();
 
 	// Schedule a new event/transition with specified parameters
-	void schedule(uint64_t delay_max, boolean::cube assume, boolean::cube guard, int net, int value, int strength, bool stable=true);
+	// The event is batched until the next flush(), which evaluate() and wait()
+	// call before returning
+	void schedule(uint64_t delay_max, sparse_cube assume, sparse_cube guard, int net, int value, int strength, bool stable=true);
 	
 	// Propagate changes from one net to others through connected devices
-	void propagate(deque<int> &q, int net, bool vacuous=false);
+	void propagate(worklist &q, int net, bool vacuous=false);
 	
 	// Model the behavior of a device during evaluation
-	void model(int i, bool reverse, boolean::cube &assume, boolean::cube &guard, int &value, int &drive_strength, int &glitch_value, int &glitch_strength, uint64_t &delay_max);
+	void model(int i, bool reverse, sparse_cube &assume, sparse_cube &guard, int &value, int &drive_strength, int &glitch_value, int &glitch_strength, uint64_t &delay_max);
 	
 	// Evaluate all instantaneous effects of changes to specified nets
-	void evaluate(deque<int> net);
+	void evaluate(const deque<int> &net);
+	// Evaluate the nets already waiting in dirty
+	void evaluate();
 	
 	// Fire the next event or a specific event, advancing simulation time
 	// @param net Specific net to fire, or std::numeric_limits<int>::max() for next chronological event
-	// @return The transition that was fired
+	// @return The transition that was fired, with its guard and assumptions
 	enabled_transition fire(int net=std::numeric_limits<int>::max());
+	// Apply an event taken from the queue with its guard and assumptions
+	void commit(const enabled_event &e, const sparse_cube &assume, const sparse_cube &guard);
+
+	// Fire events in order until none are left, the next one is after until,
+	// events of them have fired, one fires on a watched net, or stop returns
+	// true for one, whichever comes first. Unlike a loop over fire(), the
+	// fired transitions are never assembled, so their guards and assumptions
+	// are not moved out of terms and no cubes are copied.
+	template <typename F>
+	run_result run_until(uint64_t until, uint64_t events, F stop);
+	run_result run_until(uint64_t until=std::numeric_limits<uint64_t>::max(), uint64_t events=std::numeric_limits<uint64_t>::max());
+	// Start or stop watching a net for run_until()
+	void watch(int net, bool on=true);
 
 	// Apply assumptions about signal values to the simulation
 	// NOTE: Does NOT set signal values directly, only cancels contradicting events
 	// @param assume Boolean cube representing the assumed signal values
-	void assume(boolean::cube assume);
+	void assume(const boolean::cube &assume);
+	void assume(const sparse_cube &assume);
 
 	// Set a value on a specific net in the simulation
-	void set(int net, int value, int strength=3, bool stable=true, deque<int> *q=nullptr);
+	void set(int net, int value, int strength=3, bool stable=true, worklist *q=nullptr);
 	
 	// Set multiple values simultaneously using a boolean cube
-	void set(boolean::cube action, int strength=3, bool stable=true, deque<int> *q=nullptr);
+	void set(boolean::cube action, int strength=3, bool stable=true, worklist *q=nullptr);
 
 	// Reset the simulation to initial state
 	void reset();
@@ -139,5 +388,55 @@ struct simulator {
 	void run();
 };
 
+// stop is called with each event after it fires. The time limit peeks at the
+// front of the queue before each event, so it is only checked if one is set.
+template <typename Q>
+template <typename F>
+run_result basic_simulator<Q>::run_until(uint64_t until, uint64_t events, F stop) {
+	run_result result;
+	while (true) {
+		if (result.fired >= events) {
+			result.reason = run_result::events;
+			break;
+		} else if (enabled.empty()) {
+			result.reason = run_result::drained;
+			break;
+		} else if (until != std::numeric_limits<uint64_t>::max() and enabled[enabled.next()].value.fire_at > until) {
+			result.reason = run_result::time;
+			break;
+		}
+
+		enabled_event e = enabled.pop();
+		now = enabled.now;
+		if (e.net < 0 or e.net >= (int)nets.size()) {
+			continue;
+		}
+		at(e.net) = queue::nil;
+		commit(e, terms[e.net].assume, terms[e.net].guard);
+		result.fired++;
+		result.net = e.net;
+
+		if (e.net < (int)watched.size() and watched[e.net]) {
+			result.reason = run_result::watched;
+			break;
+		} else if (stop(e)) {
+			result.reason = run_result::stopped;
+			break;
+		}
+	}
+	return result;
+}
+
+// The calendar queue backend scales to large designs, while the radix heap
+// needs no tuning and tends to win on small cells.
+using calendar_backend = calendar_queue<enabled_event, enabled_priority, day_bitmap, arena_events<enabled_event> >;
+using radix_backend = radix_heap<enabled_event, enabled_priority>;
+
+extern template struct basic_simulator<calendar_backend>;
+extern template struct basic_simulator<radix_backend>;
+
+using simulator = basic_simulator<calendar_backend>;
+using radix_simulator = basic_simulator<radix_backend>;
+
 }
 
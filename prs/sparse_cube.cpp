@@ -0,0 +1,121 @@
+#include "sparse_cube.h"
+
+namespace prs
+{
+
+sparse_cube::sparse_cube() {
+	count = 0;
+}
+
+sparse_cube::sparse_cube(int var, int val) {
+	count = 0;
+	set(var, val);
+}
+
+sparse_cube::sparse_cube(const boolean::cube &c) {
+	count = 0;
+	for_each_literal(c, [this](int var, int val) {
+		set(var, val);
+	});
+}
+
+sparse_cube::~sparse_cube() {
+}
+
+const literal *sparse_cube::begin() const {
+	return count <= (int)small.size() ? small.data() : large.data();
+}
+
+const literal *sparse_cube::end() const {
+	return begin()+count;
+}
+
+int sparse_cube::size() const {
+	return count;
+}
+
+int sparse_cube::get(int var) const {
+	for (auto l = begin(); l != end(); l++) {
+		if (l->var == var) {
+			return l->val;
+		}
+	}
+	return 2;
+}
+
+void sparse_cube::set(int var, int val) {
+	literal *data = count <= (int)small.size() ? small.data() : large.data();
+	for (int i = 0; i < count; i++) {
+		if (data[i].var == var) {
+			data[i].val = val;
+			return;
+		}
+	}
+
+	if (count < (int)small.size()) {
+		small[count] = literal{var, val};
+	} else {
+		if (count == (int)small.size()) {
+			large.assign(small.begin(), small.end());
+		}
+		large.push_back(literal{var, val});
+	}
+	count++;
+}
+
+bool sparse_cube::is_tautology() const {
+	return count == 0;
+}
+
+sparse_cube sparse_cube::xoutnulls() const {
+	sparse_cube result;
+	for (auto l = begin(); l != end(); l++) {
+		if (l->val != -1) {
+			result.set(l->var, l->val);
+		}
+	}
+	return result;
+}
+
+bool sparse_cube::conflicts(const boolean::cube &state) const {
+	for (auto l = begin(); l != end(); l++) {
+		int val = state.get(l->var);
+		val = val == -1 ? 2 : val;
+		if ((((val+1)&(l->val+1))-1) == -1) {
+			return true;
+		}
+	}
+	return false;
+}
+
+boolean::cube sparse_cube::cube() const {
+	boolean::cube result;
+	for (auto l = begin(); l != end(); l++) {
+		result.set(l->var, l->val);
+	}
+	return result;
+}
+
+// Values are intersected with the same bitwise and as boolean::cube, in
+// which 2 is the identity and -1 absorbs everything.
+sparse_cube &sparse_cube::operator&=(const sparse_cube &c) {
+	for (auto l = c.begin(); l != c.end(); l++) {
+		int val = get(l->var);
+		set(l->var, ((val+1)&(l->val+1))-1);
+	}
+	return *this;
+}
+
+sparse_cube operator&(sparse_cube a, const sparse_cube &b) {
+	a &= b;
+	return a;
+}
+
+boolean::cube &operator&=(boolean::cube &c, const sparse_cube &s) {
+	for (auto l = s.begin(); l != s.end(); l++) {
+		c.set(l->var, ((c.get(l->var)+1)&(l->val+1))-1);
+	}
+	return c;
+}
+
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <common/standard.h>
+#include <boolean/cube.h>
+
+#include <array>
+#include <vector>
+
+using namespace std;
+
+namespace prs
+{
+
+// A single literal of a sparse_cube. val uses the same encoding as
+// boolean::cube::get(): 1=high, 0=low, -1=null/interference.
+struct literal {
+	int var;
+	int val;
+};
+
+// A conjunction of a handful of literals, used for the guards and
+// assumptions of the simulator's transitions. A boolean::cube stores two
+// bits for every net up to the highest one it mentions, so combining it with
+// the circuit state costs O(nets). A guard typically has one to four
+// literals, so a sparse_cube stores (net, value) pairs instead, inline for up
+// to four literals and on the heap beyond that, and every operation scales
+// with the number of literals. Use cube() to convert for export.
+struct sparse_cube {
+	sparse_cube();
+	sparse_cube(int var, int val);
+	explicit sparse_cube(const boolean::cube &c);
+	~sparse_cube();
+
+	int count;
+	array<literal, 4> small;
+	vector<literal> large;
+
+	const literal *begin() const;
+	const literal *end() const;
+	int size() const;
+
+	// value of var in this cube, 2 if unconstrained
+	int get(int var) const;
+	// constrain var to val, replacing any previous constraint
+	void set(int var, int val);
+
+	bool is_tautology() const;
+	// drop literals that intersected to null, as boolean::cube::xoutnulls()
+	sparse_cube xoutnulls() const;
+	// true if some literal contradicts a known value of state, ignoring
+	// nets that are -1 in state. Equivalent to
+	// are_mutex(state.xoutnulls(), cube()) without the dense copies.
+	bool conflicts(const boolean::cube &state) const;
+
+	boolean::cube cube() const;
+
+	sparse_cube &operator&=(const sparse_cube &c);
+};
+
+sparse_cube operator&(sparse_cube a, const sparse_cube &b);
+
+// Call f(var, val) for each literal of a dense cube in order of var. A cube
+// packs sixteen two bit values into each word, with 11 for an unconstrained
+// net, so the constrained nets of a word are the pairs that are not 11, and
+// whole words of unconstrained nets are skipped at once.
+template <typename F>
+void for_each_literal(const boolean::cube &c, F f) {
+	for (int w = 0; w < (int)c.values.size(); w++) {
+		unsigned int v = c.values[w];
+		unsigned int set = ~(v & (v >> 1)) & 0x55555555u;
+		while (set != 0) {
+			int b = __builtin_ctz(set);
+			f(w*16 + b/2, (int)((v >> b) & 3) - 1);
+			set &= set-1;
+		}
+	}
+}
+
+// Intersect a dense cube with a sparse one, touching only the literals of s
+boolean::cube &operator&=(boolean::cube &c, const sparse_cube &s);
+
+}
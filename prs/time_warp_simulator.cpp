@@ -0,0 +1,404 @@
+#include "time_warp_simulator.h"
+
+#include <algorithm>
+#include <barrier>
+#include <iterator>
+#include <thread>
+
+namespace prs {
+
+static const uint64_t never = std::numeric_limits<uint64_t>::max();
+static const int last_net = std::numeric_limits<int>::max();
+
+// Step of the next event in a simulator's queue
+static warp_time next_step(simulator &sim) {
+	simulator::queue::handle h = sim.enabled.next();
+	if (h == simulator::queue::nil) {
+		return warp_time(never, last_net);
+	}
+	return warp_time(sim.enabled[h].value.fire_at, sim.enabled[h].value.net);
+}
+
+// Step of the change a message carries
+static warp_time stepof(const warp_message &m) {
+	return warp_time(m.event.fire_at, m.order);
+}
+
+static std::tuple<uint64_t, int, int, uint64_t> keyof(const warp_message &m) {
+	return std::make_tuple(m.event.fire_at, m.order, m.from, m.id);
+}
+
+static bool same(const enabled_event &e0, const enabled_event &e1) {
+	return e0.fire_at == e1.fire_at and e0.net == e1.net and e0.value == e1.value and e0.strength == e1.strength and e0.stable == e1.stable;
+}
+
+warp_message::warp_message() {
+	order = -1;
+	from = -1;
+	id = 0;
+	anti = false;
+}
+
+warp_message::warp_message(enabled_event event, int order, int from, uint64_t id, bool anti) {
+	this->event = event;
+	this->order = order;
+	this->from = from;
+	this->id = id;
+	this->anti = anti;
+}
+
+warp_message::~warp_message() {
+}
+
+warp_checkpoint::warp_checkpoint() {
+	time = 0;
+	last = warp_time(0, last_net);
+	now = 0;
+	for (int c = 0; c < 3; c++) {
+		size[c] = 0;
+	}
+}
+
+warp_checkpoint::~warp_checkpoint() {
+}
+
+warp_worker::warp_worker() {
+	last = warp_time(0, last_net);
+	since = 0;
+	ids = 0;
+	rollbacks = 0;
+	annihilated = 0;
+}
+
+warp_worker::~warp_worker() {
+}
+
+time_warp_simulator::time_warp_simulator() {
+	interval = 8;
+	epoch = 256;
+	gvt = 0;
+	quiet = true;
+}
+
+time_warp_simulator::time_warp_simulator(const production_rule_set *base, int workers) : region_simulator(base, workers) {
+	interval = 8;
+	epoch = 256;
+	gvt = 0;
+	quiet = true;
+
+	warp.resize(part.workers);
+	for (int i = 0; i < part.workers*part.workers; i++) {
+		links.push_back(std::unique_ptr<mailbox<warp_message> >(new mailbox<warp_message>()));
+	}
+	horizon.assign(part.workers, warp_time(never, last_net));
+	sent.assign(part.workers, 0);
+}
+
+time_warp_simulator::~time_warp_simulator() {
+}
+
+warp_time time_warp_simulator::pending(int w) {
+	warp_time result = next_step(sims[w]);
+	if (not warp[w].inbox.empty()) {
+		result = std::min(result, stepof(warp[w].inbox.begin()->second));
+	}
+	return result;
+}
+
+void time_warp_simulator::checkpoint(int w, uint64_t time) {
+	simulator &sim = sims[w];
+	warp_worker &k = warp[w];
+
+	warp_checkpoint cp;
+	cp.time = time;
+	cp.last = k.last;
+	cp.now = sim.now;
+
+	boolean::cube *cubes[3] = {&sim.encoding, &sim.global, &sim.strength};
+	for (int c = 0; c < 3; c++) {
+		vector<unsigned int> &live = cubes[c]->values;
+		vector<unsigned int> &prev = k.shadow[c];
+		cp.size[c] = (int)prev.size();
+		int n = (int)std::min(live.size(), prev.size());
+		for (int i = 0; i < n; i++) {
+			if (live[i] != prev[i]) {
+				cp.undo[c].push_back(pair<int, unsigned int>(i, prev[i]));
+				prev[i] = live[i];
+			}
+		}
+		prev.resize(live.size());
+		for (int i = n; i < (int)live.size(); i++) {
+			prev[i] = live[i];
+		}
+	}
+
+	for (int net = 0; net < (int)sim.nets.size(); net++) {
+		if (sim.nets[net] != simulator::queue::nil) {
+			cp.events.push_back(sim.enabled[sim.nets[net]].value);
+			cp.terms.push_back(sim.terms[net]);
+		}
+	}
+
+	k.checkpoints.push_back(cp);
+	k.since = 0;
+}
+
+void time_warp_simulator::rollback(int w, uint64_t time) {
+	simulator &sim = sims[w];
+	warp_worker &k = warp[w];
+	k.rollbacks++;
+
+	// The latest checkpoint at or before time. Fossil collection always
+	// keeps one at or before the global virtual time.
+	int j = (int)k.checkpoints.size()-1;
+	while (j > 0 and k.checkpoints[j].time > time) {
+		j--;
+	}
+
+	// Return to the latest checkpoint, then undo the checkpoints after j
+	boolean::cube *cubes[3] = {&sim.encoding, &sim.global, &sim.strength};
+	for (int c = 0; c < 3; c++) {
+		vector<unsigned int> &live = cubes[c]->values;
+		live = k.shadow[c];
+		for (int i = (int)k.checkpoints.size()-1; i > j; i--) {
+			const warp_checkpoint &cp = k.checkpoints[i];
+			live.resize(cp.size[c]);
+			for (auto u = cp.undo[c].begin(); u != cp.undo[c].end(); u++) {
+				live[u->first] = u->second;
+			}
+		}
+		k.shadow[c] = live;
+	}
+	k.checkpoints.resize(j+1);
+
+	const warp_checkpoint &cp = k.checkpoints[j];
+	sim.enabled.clear();
+	sim.nets.assign(sim.nets.size(), simulator::queue::nil);
+	for (int i = 0; i < (int)cp.events.size(); i++) {
+		int net = cp.events[i].net;
+		sim.nets[net] = sim.enabled.push(cp.events[i]);
+		sim.terms[net] = cp.terms[i];
+	}
+	sim.now = cp.now;
+	sim.outbox.clear();
+	k.last = cp.last;
+	k.since = 0;
+
+	// Messages applied after the checkpoint are applied again
+	while (not k.processed.empty() and k.processed.back().event.fire_at >= cp.time) {
+		const warp_message &m = k.processed.back();
+		k.inbox.insert(std::make_pair(keyof(m), m));
+		k.processed.pop_back();
+	}
+
+	// Messages sent after the checkpoint become suspect
+	auto s = k.sent.end();
+	while (s != k.sent.begin() and std::prev(s)->second.event.fire_at >= cp.time) {
+		s--;
+	}
+	k.suspect.insert(k.suspect.end(), s, k.sent.end());
+	k.sent.erase(s, k.sent.end());
+	std::stable_sort(k.suspect.begin(), k.suspect.end(), [](const pair<int, warp_message> &a, const pair<int, warp_message> &b) {
+		return stepof(a.second) < stepof(b.second);
+	});
+}
+
+// Nothing before gvt can be rolled back, so keep the latest checkpoint at or
+// before it, and the logs from that checkpoint on
+void time_warp_simulator::fossils(int w, uint64_t gvt) {
+	warp_worker &k = warp[w];
+	int j = 0;
+	while (j+1 < (int)k.checkpoints.size() and k.checkpoints[j+1].time <= gvt) {
+		j++;
+	}
+	k.checkpoints.erase(k.checkpoints.begin(), k.checkpoints.begin()+j);
+	for (int c = 0; c < 3; c++) {
+		k.checkpoints.front().undo[c].clear();
+	}
+
+	uint64_t oldest = k.checkpoints.front().time;
+	auto p = k.processed.begin();
+	while (p != k.processed.end() and p->event.fire_at < oldest) {
+		p++;
+	}
+	k.processed.erase(k.processed.begin(), p);
+
+	auto s = k.sent.begin();
+	while (s != k.sent.end() and s->second.event.fire_at < oldest) {
+		s++;
+	}
+	k.sent.erase(k.sent.begin(), s);
+}
+
+void time_warp_simulator::drain(int w) {
+	warp_worker &k = warp[w];
+	for (int from = 0; from < part.workers; from++) {
+		mailbox<warp_message> &box = *links[from*part.workers + w];
+		warp_message m;
+		while (box.pop(m)) {
+			// A change for a step before the last one this worker processed
+			// is a straggler. A change for the last step continues it, as
+			// another delta cycle does in region_simulator. An anti-message
+			// always follows its change on the same link, so its change has
+			// either been applied or is waiting in the inbox.
+			if (stepof(m) < k.last or (m.anti and stepof(m) == k.last)) {
+				rollback(w, m.event.fire_at);
+			}
+			if (m.anti) {
+				k.inbox.erase(keyof(m));
+				k.annihilated++;
+			} else {
+				k.inbox.insert(std::make_pair(keyof(m), m));
+			}
+		}
+	}
+}
+
+void time_warp_simulator::send(int w, warp_time t) {
+	warp_worker &k = warp[w];
+	vector<enabled_event> &outbox = sims[w].outbox;
+	for (auto e = outbox.begin(); e != outbox.end(); e++) {
+		e->fire_at = t.first;
+		for (int to : part.importers[e->net]) {
+			// A message that was sent before the rollback is still valid
+			auto s = k.suspect.begin();
+			while (s != k.suspect.end() and stepof(s->second) <= t and not (s->first == to and s->second.order == t.second and same(s->second.event, *e))) {
+				s++;
+			}
+			if (s != k.suspect.end() and stepof(s->second) <= t) {
+				k.sent.push_back(*s);
+				k.suspect.erase(s);
+				continue;
+			}
+
+			warp_message m(*e, t.second, w, k.ids++);
+			links[w*part.workers + to]->push(m);
+			k.sent.push_back(pair<int, warp_message>(to, m));
+		}
+	}
+	outbox.clear();
+}
+
+bool time_warp_simulator::cancel(int w, warp_time t) {
+	warp_worker &k = warp[w];
+	auto s = k.suspect.begin();
+	for (; s != k.suspect.end() and stepof(s->second) < t; s++) {
+		warp_message m = s->second;
+		m.anti = true;
+		links[w*part.workers + s->first]->push(m);
+	}
+	bool result = s != k.suspect.begin();
+	k.suspect.erase(k.suspect.begin(), s);
+	return result;
+}
+
+// The event of the step fires if it belongs to this worker, then the
+// changes it caused in other workers are applied. Checkpoints are only taken
+// at the first step of a time, since a rollback restores whole times.
+void time_warp_simulator::step(int w, warp_time t) {
+	simulator &sim = sims[w];
+	warp_worker &k = warp[w];
+
+	cancel(w, t);
+	if (k.since >= interval and k.last.first < t.first and (k.checkpoints.empty() or k.checkpoints.back().time < t.first)) {
+		checkpoint(w, t.first);
+	}
+
+	if (next_step(sim) == t) {
+		sim.fire();
+	}
+	while (not k.inbox.empty() and stepof(k.inbox.begin()->second) == t) {
+		warp_message m = k.inbox.begin()->second;
+		k.inbox.erase(k.inbox.begin());
+		sim.now = t.first;
+		sim.set(m.event.net, m.event.value, m.event.strength, m.event.stable);
+		k.processed.push_back(m);
+	}
+
+	send(w, t);
+	cancel(w, warp_time(t.first, t.second+1));
+	k.last = t;
+	k.since++;
+}
+
+bool time_warp_simulator::advance(uint64_t until) {
+	const int n = part.workers;
+
+	// Every step before now is final, so each worker starts from a single
+	// checkpoint of its current state
+	for (int w = 0; w < n; w++) {
+		warp_worker &k = warp[w];
+		k.checkpoints.clear();
+		k.processed.clear();
+		k.sent.clear();
+		k.suspect.clear();
+		k.shadow[0] = sims[w].encoding.values;
+		k.shadow[1] = sims[w].global.values;
+		k.shadow[2] = sims[w].strength.values;
+		k.last = warp_time(now, last_net);
+		checkpoint(w, now);
+	}
+
+	// The completion step of the barrier runs once all workers have arrived
+	// and before any is released, so it can combine their reports
+	std::barrier sync(n, [this]() noexcept {
+		gvt = std::min_element(horizon.begin(), horizon.end())->first;
+		quiet = std::find(sent.begin(), sent.end(), 1) == sent.end();
+	});
+
+	// Suspect messages after until are never sent again
+	warp_time stop = until == never ? warp_time(never, last_net) : warp_time(until+1, 0);
+
+	auto work = [&](int w) {
+		while (true) {
+			// Speculate
+			for (int s = 0; s < epoch; s++) {
+				drain(w);
+				warp_time t = pending(w);
+				if (t.first > until or t.first == never) {
+					break;
+				}
+				step(w, t);
+			}
+
+			// Deliver every message in flight, including the anti-messages
+			// that this produces, then agree on the global virtual time
+			sync.arrive_and_wait();
+			do {
+				drain(w);
+				horizon[w] = pending(w);
+				sent[w] = cancel(w, std::min(horizon[w], stop));
+				sync.arrive_and_wait();
+			} while (not quiet);
+
+			fossils(w, gvt);
+			if (gvt > until or gvt == never) {
+				break;
+			}
+		}
+	};
+
+	vector<std::thread> threads;
+	for (int w = 1; w < n; w++) {
+		threads.push_back(std::thread(work, w));
+	}
+	work(0);
+	for (auto t = threads.begin(); t != threads.end(); t++) {
+		t->join();
+	}
+
+	for (int w = 0; w < n; w++) {
+		if (warp[w].last.first != never) {
+			now = std::max(now, warp[w].last.first);
+		}
+	}
+	for (int w = 0; w < n; w++) {
+		warp[w].checkpoints.clear();
+		warp[w].processed.clear();
+		warp[w].sent.clear();
+	}
+
+	return earliest() != never;
+}
+
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "region_simulator.h"
+#include "mailbox.h"
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <tuple>
+
+namespace prs {
+
+// The virtual time of a step: the firing time, and the net of the event
+// that fires at the start of the step. Events at the same time fire in order
+// of net, as they do from a single queue, and each step also applies the
+// changes that its event caused in other workers.
+typedef pair<uint64_t, int> warp_time;
+
+// A change forwarded between workers, or an anti-message that cancels a
+// change sent earlier with the same sender and id
+struct warp_message {
+	warp_message();
+	warp_message(enabled_event event, int order, int from, uint64_t id, bool anti=false);
+	~warp_message();
+
+	enabled_event event; // fire_at is the time of the change
+	int order;           // with fire_at, the step that made the change
+	int from;
+	uint64_t id;
+	bool anti;
+};
+
+// The state of a worker's simulator before it processed the events at time.
+// The event queue is saved as the list of pending events. The cubes are
+// saved incrementally: each checkpoint keeps the words of encoding, global,
+// and strength that changed since the checkpoint before it, with their
+// values at that earlier checkpoint, so that rolling back undoes the
+// checkpoints in reverse order.
+struct warp_checkpoint {
+	warp_checkpoint();
+	~warp_checkpoint();
+
+	uint64_t time;   // first time that was not yet processed
+	warp_time last;  // the last step that was processed
+	uint64_t now;
+
+	vector<enabled_event> events;
+	vector<enabled_terms> terms;
+
+	// encoding, global, and strength at the previous checkpoint
+	int size[3];
+	vector<pair<int, unsigned int> > undo[3];
+};
+
+// One worker of the time warp simulator
+struct warp_worker {
+	warp_worker();
+	~warp_worker();
+
+	// The last step processed
+	warp_time last;
+	// Steps processed since the last checkpoint
+	int since;
+
+	// Messages waiting to be applied, in the order they are applied, keyed
+	// by time, order, sender, and id
+	std::map<std::tuple<uint64_t, int, int, uint64_t>, warp_message> inbox;
+	// Messages applied since the oldest checkpoint, in time order
+	vector<warp_message> processed;
+
+	// Messages sent since the oldest checkpoint, in step order, and the
+	// destination of each
+	vector<pair<int, warp_message> > sent;
+	// Messages sent by steps that were rolled back. A message that the
+	// worker sends again when it processes the same step is kept, and the
+	// rest are cancelled once the worker moves past their time.
+	vector<pair<int, warp_message> > suspect;
+	uint64_t ids;
+
+	std::deque<warp_checkpoint> checkpoints;
+	// encoding, global, and strength as of the latest checkpoint
+	vector<unsigned int> shadow[3];
+
+	uint64_t rollbacks;
+	uint64_t annihilated;
+};
+
+// Runs the workers of a region_simulator optimistically. Each worker fires
+// its own events as soon as it can without waiting for the others, and
+// applies each change it receives at the time it was made. If a change
+// arrives for a time the worker already processed, the worker rolls back to
+// a checkpoint before that time and processes those steps again. Messages it
+// sent during the steps that were rolled back and does not send again are
+// cancelled with anti-messages, which may roll back their receivers in turn.
+//
+// The workers run in epochs of at most epoch steps each. At the end of an
+// epoch they stop, deliver all messages in flight, and agree on the global
+// virtual time, the earliest time any worker has yet to process. No worker
+// can be rolled back before it, so checkpoints and logs older than that are
+// discarded. advance() returns once the global virtual time passes until.
+//
+// Unlike region_simulator, no worker waits on the others at every firing
+// time, which suits circuits with many zero delay crossings between
+// workers. Each step fires at most one event, so events at the same time
+// take effect in order of net across all workers as they do in
+// region_simulator, and the result matches a single simulator with fixed
+// delays with the same exceptions.
+struct time_warp_simulator : region_simulator {
+	time_warp_simulator();
+	time_warp_simulator(const production_rule_set *base, int workers);
+	~time_warp_simulator();
+
+	// Steps between checkpoints, and steps per epoch
+	int interval;
+	int epoch;
+
+	vector<warp_worker> warp;
+
+	// links[from*workers + to] carries messages from one worker to another
+	vector<std::unique_ptr<mailbox<warp_message> > > links;
+
+	// Scratch space for the agreement at the end of each epoch
+	vector<warp_time> horizon;
+	vector<char> sent;
+	uint64_t gvt;
+	bool quiet;
+
+	bool advance(uint64_t until=std::numeric_limits<uint64_t>::max());
+
+	// Earliest step that worker w has yet to process
+	warp_time pending(int w);
+
+	void checkpoint(int w, uint64_t time);
+	void rollback(int w, uint64_t time);
+	void fossils(int w, uint64_t gvt);
+
+	// Read every message waiting for worker w
+	void drain(int w);
+	// Send the changes in the outbox of worker w, made in step t
+	void send(int w, warp_time t);
+	// Cancel the suspect messages of worker w made before step t. Returns
+	// true if anything was sent.
+	bool cancel(int w, warp_time t);
+	// Fire the event and apply the messages of worker w in step t
+	void step(int w, warp_time t);
+};
+
+}
@@ -0,0 +1,303 @@
+#include "trace.h"
+
+#include <chrono>
+#include <string.h>
+
+namespace prs {
+
+static const char magic[8] = {'P', 'R', 'S', 'T', 'R', 'A', 'C', 'E'};
+static const uint64_t version = 1;
+
+static void put_varint(vector<uint8_t> &out, uint64_t v) {
+	while (v >= 0x80) {
+		out.push_back((uint8_t)(v | 0x80));
+		v >>= 7;
+	}
+	out.push_back((uint8_t)v);
+}
+
+static bool get_varint(FILE *fp, uint64_t &v) {
+	v = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		int c = fgetc(fp);
+		if (c == EOF) {
+			return false;
+		}
+		v |= (uint64_t)(c & 0x7F) << shift;
+		if ((c & 0x80) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static uint64_t zigzag(int64_t v) {
+	return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v) {
+	return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+trace_record::trace_record() {
+	time = 0;
+	net = -1;
+	value = 2;
+	strength = 0;
+	stable = true;
+}
+
+trace_record::trace_record(uint64_t time, int net, int value, int strength, bool stable) {
+	this->time = time;
+	this->net = net;
+	this->value = (int8_t)value;
+	this->strength = (int8_t)strength;
+	this->stable = stable;
+}
+
+trace_record::~trace_record() {
+}
+
+trace_writer::trace_writer() {
+	overflow = wait;
+	dropped = 0;
+	fp = nullptr;
+	done = false;
+	last_time = 0;
+	last_net = 0;
+	written = 0;
+}
+
+trace_writer::~trace_writer() {
+	close();
+}
+
+bool trace_writer::open(const production_rule_set *base, string path, int capacity) {
+	close();
+	fp = fopen(path.c_str(), "wb");
+	if (fp == nullptr) {
+		return false;
+	}
+
+	buffer.clear();
+	buffer.insert(buffer.end(), magic, magic+sizeof(magic));
+	put_varint(buffer, version);
+	put_varint(buffer, base->nets.size());
+	for (int i = 0; i < (int)base->nets.size(); i++) {
+		string name = base->netAt(i);
+		put_varint(buffer, name.size());
+		buffer.insert(buffer.end(), name.begin(), name.end());
+	}
+
+	records.resize(capacity);
+	dropped = 0;
+	last_time = 0;
+	last_net = 0;
+	written = 0;
+	done = false;
+	writer = std::thread(&trace_writer::run, this);
+	return true;
+}
+
+void trace_writer::close() {
+	if (fp == nullptr) {
+		return;
+	}
+
+	done = true;
+	writer.join();
+	fclose(fp);
+	fp = nullptr;
+}
+
+bool trace_writer::is_open() const {
+	return fp != nullptr;
+}
+
+void trace_writer::encode(const trace_record &r) {
+	put_varint(buffer, zigzag((int64_t)(r.time - last_time)));
+	uint64_t flags = (uint64_t)(r.value+1) | ((uint64_t)r.strength << 2) | ((uint64_t)r.stable << 4);
+	put_varint(buffer, (zigzag((int64_t)r.net - (int64_t)last_net) << 5) | flags);
+	last_time = r.time;
+	last_net = r.net;
+	written++;
+}
+
+void trace_writer::drain() {
+	if (not buffer.empty()) {
+		fwrite(buffer.data(), 1, buffer.size(), fp);
+		buffer.clear();
+	}
+}
+
+void trace_writer::run() {
+	static const size_t block = 1 << 16;
+	trace_record r;
+	while (true) {
+		// Read done before draining so nothing pushed before close() is missed
+		bool stop = done.load(std::memory_order_acquire);
+		bool idle = true;
+		while (records.pop(r)) {
+			encode(r);
+			idle = false;
+			if (buffer.size() >= block) {
+				drain();
+			}
+		}
+		if (stop) {
+			break;
+		} else if (idle) {
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+	}
+	drain();
+	fflush(fp);
+}
+
+trace_reader::trace_reader() {
+	fp = nullptr;
+	last_time = 0;
+	last_net = 0;
+}
+
+trace_reader::~trace_reader() {
+	close();
+}
+
+bool trace_reader::open(string path) {
+	close();
+	fp = fopen(path.c_str(), "rb");
+	if (fp == nullptr) {
+		return false;
+	}
+
+	char header[sizeof(magic)];
+	uint64_t v = 0, count = 0;
+	if (fread(header, 1, sizeof(header), fp) != sizeof(header)
+		or memcmp(header, magic, sizeof(magic)) != 0
+		or not get_varint(fp, v) or v != version
+		or not get_varint(fp, count)) {
+		close();
+		return false;
+	}
+
+	names.clear();
+	names.reserve(count);
+	for (uint64_t i = 0; i < count; i++) {
+		uint64_t size = 0;
+		if (not get_varint(fp, size)) {
+			close();
+			return false;
+		}
+		string name(size, ' ');
+		if (size > 0 and fread(&name[0], 1, size, fp) != size) {
+			close();
+			return false;
+		}
+		names.push_back(name);
+	}
+
+	last_time = 0;
+	last_net = 0;
+	return true;
+}
+
+void trace_reader::close() {
+	if (fp != nullptr) {
+		fclose(fp);
+		fp = nullptr;
+	}
+}
+
+bool trace_reader::next(trace_record &r) {
+	uint64_t dt = 0, packed = 0;
+	if (fp == nullptr or not get_varint(fp, dt) or not get_varint(fp, packed)) {
+		return false;
+	}
+
+	r.time = last_time + (uint64_t)unzigzag(dt);
+	r.net = (int)((int64_t)last_net + unzigzag(packed >> 5));
+	r.value = (int8_t)((int)(packed & 3) - 1);
+	r.strength = (int8_t)((packed >> 2) & 3);
+	r.stable = ((packed >> 4) & 1) != 0;
+	last_time = r.time;
+	last_net = r.net;
+	return true;
+}
+
+// VCD identifiers are short strings of the printable characters '!' to '~'
+static string vcd_id(int net) {
+	string result;
+	do {
+		result.push_back((char)('!' + net%94));
+		net /= 94;
+	} while (net > 0);
+	return result;
+}
+
+bool export_vcd(string trace_path, string vcd_path, string timescale) {
+	trace_reader in;
+	if (not in.open(trace_path)) {
+		return false;
+	}
+
+	FILE *out = fopen(vcd_path.c_str(), "w");
+	if (out == nullptr) {
+		return false;
+	}
+
+	fprintf(out, "$timescale %s $end\n", timescale.c_str());
+	fprintf(out, "$scope module top $end\n");
+	for (int i = 0; i < (int)in.names.size(); i++) {
+		fprintf(out, "$var wire 1 %s %s $end\n", vcd_id(i).c_str(), in.names[i].c_str());
+	}
+	fprintf(out, "$upscope $end\n");
+	fprintf(out, "$enddefinitions $end\n");
+
+	fprintf(out, "#0\n$dumpvars\n");
+	for (int i = 0; i < (int)in.names.size(); i++) {
+		fprintf(out, "x%s\n", vcd_id(i).c_str());
+	}
+	fprintf(out, "$end\n");
+
+	// A VCD may not move backwards in time, so each time the trace does the
+	// rest of it is shifted to start just after the last change written.
+	uint64_t time = 0;
+	uint64_t last = 0;
+	uint64_t offset = 0;
+	trace_record r;
+	while (in.next(r)) {
+		if (r.time < last) {
+			offset += last - r.time + 1;
+			time = r.time + offset;
+			fprintf(out, "#%llu\n", (unsigned long long)time);
+			fprintf(out, "$comment time moved back to %llu $end\n", (unsigned long long)r.time);
+			fprintf(out, "$dumpall\n");
+			for (int i = 0; i < (int)in.names.size(); i++) {
+				fprintf(out, "x%s\n", vcd_id(i).c_str());
+			}
+			fprintf(out, "$end\n");
+		}
+		last = r.time;
+
+		if (r.time + offset != time) {
+			time = r.time + offset;
+			fprintf(out, "#%llu\n", (unsigned long long)time);
+		}
+
+		char value = 'z';
+		if (r.strength > 0) {
+			switch (r.value) {
+			case -1: value = 'x'; break;
+			case 0: value = '0'; break;
+			case 1: value = '1'; break;
+			}
+		}
+		fprintf(out, "%c%s\n", value, vcd_id(r.net).c_str());
+	}
+
+	fclose(out);
+	return true;
+}
+
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "production_rule.h"
+#include "ring.h"
+#include <common/standard.h>
+
+#include <atomic>
+#include <stdio.h>
+#include <thread>
+
+namespace prs {
+
+// A change to the value or strength of a net, as recorded by trace_writer
+struct trace_record {
+	trace_record();
+	trace_record(uint64_t time, int net, int value, int strength, bool stable);
+	~trace_record();
+
+	uint64_t time;
+	int net;
+	int8_t value;     // 1=high, 0=low, -1=unstable/interference, 2=undriven
+	int8_t strength;  // 0=floating, 1=weak, 2=normal, 3=power
+	bool stable;
+};
+
+// Streams the changes made by a simulator to a file without slowing it down
+// much. The simulator pushes each change into a ring of fixed capacity,
+// which costs a store and a release and never allocates, and a writer thread
+// drains the ring, encodes the changes, and writes them out in large blocks.
+// If the simulator outruns the writer and fills the ring, overflow decides
+// whether record() waits for room or drops the change and counts it.
+//
+// The file starts with "PRSTRACE", a version, and the name of every net, so
+// it can be read back without the circuit. Each change then takes two
+// varints: the difference in time from the previous change, and the
+// difference in net index packed with the value, strength, and stability.
+// Both differences are zigzag encoded since restore() and reset() may move
+// time backwards. Most changes fit in two to four bytes.
+struct trace_writer {
+	trace_writer();
+	~trace_writer();
+
+	trace_writer(const trace_writer &t) = delete;
+	trace_writer &operator=(const trace_writer &t) = delete;
+
+	// What record() does when the ring is full
+	enum {
+		wait = 0,  // wait for the writer thread to make room
+		drop = 1   // drop the change and count it in dropped
+	};
+	int overflow;
+
+	ring<trace_record> records;
+	// Changes dropped because the ring was full, written by the simulator
+	uint64_t dropped;
+
+	FILE *fp;
+	std::thread writer;
+	std::atomic<bool> done;
+
+	// Owned by the writer thread while the file is open
+	vector<uint8_t> buffer;
+	uint64_t last_time;
+	int last_net;
+	uint64_t written;
+
+	// Start tracing the nets of base into the file at path through a ring
+	// that holds capacity changes, returning false if it cannot be opened
+	bool open(const production_rule_set *base, string path, int capacity=1<<16);
+	// Write out the remaining changes and close the file
+	void close();
+	bool is_open() const;
+
+	// Called by the simulator for each change
+	void record(uint64_t time, int net, int value, int strength, bool stable) {
+		trace_record r(time, net, value, strength, stable);
+		while (not records.push(r)) {
+			if (overflow == drop) {
+				dropped++;
+				return;
+			}
+			std::this_thread::yield();
+		}
+	}
+
+	// Body of the writer thread
+	void run();
+	void encode(const trace_record &r);
+	void drain();
+};
+
+// Reads back the changes written by trace_writer, in the order they happened
+struct trace_reader {
+	trace_reader();
+	~trace_reader();
+
+	trace_reader(const trace_reader &t) = delete;
+	trace_reader &operator=(const trace_reader &t) = delete;
+
+	FILE *fp;
+	vector<string> names;  // name of each net
+	uint64_t last_time;
+	int last_net;
+
+	// Open a trace and read its header, returning false if it is not a trace
+	bool open(string path);
+	void close();
+	// Read the next change, returning false at the end of the trace
+	bool next(trace_record &r);
+};
+
+// Convert a trace to a value change dump for waveform viewers. Undriven and
+// floating nets are written as z, and interference as x. A VCD cannot move
+// backwards in time, so when restore() or reset() does, the rest of the trace
+// is shifted to start one unit after the last change written, behind a
+// comment with the original time and a $dumpall that marks every net x,
+// since the trace does not record the values restore() put back.
+bool export_vcd(string trace_path, string vcd_path, string timescale="1ps");
+
+}
@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include <prs/production_rule.h>
+#include <prs/simulator.h>
+#include "helpers.h"
+
+#include <cstdlib>
+#include <new>
+
+using namespace prs;
+using namespace test;
+
+// Replaces the global allocator for the test binary to count the
+// allocations made on this thread while counting is set
+static thread_local bool counting = false;
+static thread_local uint64_t allocations = 0;
+
+void *operator new(std::size_t size) {
+	if (counting) {
+		allocations++;
+	}
+	void *result = std::malloc(size == 0 ? 1 : size);
+	if (result == nullptr) {
+		throw std::bad_alloc();
+	}
+	return result;
+}
+
+void *operator new[](std::size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept {
+	std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+	std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+	std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept {
+	std::free(ptr);
+}
+
+// Once the queue, the batch, and the scratch buffers have grown to fit the
+// circuit, firing an event allocates nothing
+template <typename S>
+void checkSteadyState() {
+	int enable;
+	vector<int> probe;
+	production_rule_set prs = coupled_rings(8, enable, probe);
+
+	S sim(&prs);
+	sim.delay.policy = delay_model::fixed_max;
+	sim.reset();
+	sim.set(enable, 0);
+	while (not sim.enabled.empty()) {
+		sim.fire();
+	}
+	sim.set(enable, 1);
+	for (int i = 0; i < 20000; i++) {
+		sim.fire();
+	}
+
+	allocations = 0;
+	counting = true;
+	for (int i = 0; i < 20000; i++) {
+		sim.fire();
+	}
+	counting = false;
+	EXPECT_EQ(allocations, 0u);
+}
+
+TEST(AllocationTest, CalendarFireIsAllocationFree) {
+	checkSteadyState<simulator>();
+}
+
+TEST(AllocationTest, RadixFireIsAllocationFree) {
+	checkSteadyState<radix_simulator>();
+}
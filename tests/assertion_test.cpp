@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+#include <prs/production_rule.h>
+#include <prs/simulator.h>
+#include <prs/assertion.h>
+#include "helpers.h"
+
+using namespace prs;
+using namespace test;
+
+// The outputs of two inverters may not both be high, which holds until both
+// inputs are low
+TEST(AssertionTest, InvariantAndMutex) {
+	string prs_str = R"(
+	a->x-
+	~a->x+
+
+	b->y-
+	~b->y+
+	)";
+
+	production_rule_set prs = parse_prs_string(prs_str);
+	int vdd = prs.create(net("vdd"));
+	int gnd = prs.create(net("gnd"));
+	prs.set_power(vdd, gnd);
+
+	int a = prs.netIndex("a");
+	int b = prs.netIndex("b");
+	int x = prs.netIndex("x");
+	int y = prs.netIndex("y");
+
+	assertions checker;
+	int inv = checker.invariant("not both", boolean::cover(x, 0) | boolean::cover(y, 0));
+	int mux = checker.mutex("one hot", vector<int>({x, y}));
+	ASSERT_EQ(checker.index[x], vector<int>({inv, mux}));
+	EXPECT_TRUE(checker.index[a].empty());
+
+	simulator sim(&prs);
+	sim.checker = &checker;
+	sim.reset();
+	sim.set(a, 1);
+	sim.set(b, 0);
+	sim.run_until();
+	EXPECT_TRUE(checker.violations.empty());
+
+	sim.set(a, 0);
+	sim.run_until();
+	ASSERT_EQ(checker.violations.size(), 2u);
+	EXPECT_EQ(checker.violations[0].property, inv);
+	EXPECT_EQ(checker.violations[1].property, mux);
+	EXPECT_EQ(checker.violations[0].net, x);
+	EXPECT_EQ(checker.violations[0].time, sim.now);
+	EXPECT_EQ(checker.to_string(checker.violations[0], &prs).find("@"), 0u);
+}
+
+// A buffer acknowledges its request in order, and forcing the acknowledge
+// out of turn is caught
+TEST(AssertionTest, Handshake) {
+	string prs_str = R"(
+	r->_a-
+	~r->_a+
+
+	_a->a-
+	~_a->a+
+	)";
+
+	production_rule_set prs = parse_prs_string(prs_str);
+	int vdd = prs.create(net("vdd"));
+	int gnd = prs.create(net("gnd"));
+	prs.set_power(vdd, gnd);
+
+	int r = prs.netIndex("r");
+	int a = prs.netIndex("a");
+	int _a = prs.netIndex("_a");
+
+	assertions checker;
+	int hs = checker.handshake("r/a", r, a);
+	int ihs = checker.handshake("r/_a", r, _a, true);
+
+	simulator sim(&prs);
+	sim.checker = &checker;
+	sim.reset();
+	sim.set(r, 0);
+	sim.run_until();
+	for (int i = 0; i < 4; i++) {
+		sim.set(r, 1-sim.encoding.get(r));
+		sim.run_until();
+	}
+	EXPECT_TRUE(checker.violations.empty());
+
+	sim.set(a, 1);
+	ASSERT_FALSE(checker.violations.empty());
+	EXPECT_EQ(checker.violations[0].property, hs);
+	EXPECT_EQ(checker.violations[0].net, a);
+	EXPECT_EQ(checker.violations[0].value, 1);
+
+	EXPECT_NE(hs, ihs);
+	EXPECT_EQ(checker.add(property(property::handshake, "self", vector<int>({r, r}))), -1);
+}
@@ -5,6 +5,8 @@
 #include <vector>
 #include <algorithm>
 #include <random>
+#include <set>
+#include <map>
 
 // Simple struct to use as test event with defined time
 struct TestEvent {
@@ -550,3 +552,612 @@ TEST(CalendarQueue, EmptyDaysHandlingTest) {
 	EXPECT_EQ(e2.name, "Day8");
 	EXPECT_EQ(e3.name, "Day32");
 } 
+
+/******************************************************************************
+ * OCCUPANCY BITMAP TESTS
+ *****************************************************************************/
+
+using BitmapQueue = calendar_queue<TestEvent, TestEventPriority, day_bitmap>;
+
+TEST(CalendarQueue, DayBitmapFindTest) {
+	day_bitmap index;
+	index.resize(10000u);
+
+	// Nothing is marked, so the search falls through to the end
+	EXPECT_EQ(index.find(0u, 10000u), 10000u);
+
+	index.mark(3u);
+	index.mark(64u);
+	index.mark(5000u);
+
+	EXPECT_EQ(index.find(0u, 10000u), 3u);
+	EXPECT_EQ(index.find(3u, 10000u), 3u);
+	EXPECT_EQ(index.find(4u, 10000u), 64u);
+	EXPECT_EQ(index.find(65u, 10000u), 5000u);
+	EXPECT_EQ(index.find(65u, 4000u), 4000u);
+	EXPECT_EQ(index.find(5001u, 10000u), 10000u);
+
+	index.unmark(64u);
+	EXPECT_EQ(index.find(4u, 10000u), 5000u);
+	index.unmark(5000u);
+	EXPECT_EQ(index.find(4u, 10000u), 10000u);
+}
+
+TEST(CalendarQueue, BitmapRandomOrderTest) {
+	BitmapQueue queue(8, 2);
+
+	std::mt19937 g(42);
+	std::uniform_int_distribution<uint64_t> dist(0u, 1u << 12);
+	std::vector<uint64_t> times;
+	for (int i = 0; i < 1000; i++) {
+		times.push_back(dist(g));
+		queue.push(TestEvent(times.back(), "Event" + std::to_string(i)));
+	}
+	std::sort(times.begin(), times.end());
+
+	for (size_t i = 0; i < times.size(); i++) {
+		ASSERT_FALSE(queue.empty());
+		EXPECT_EQ(queue.pop().time, times[i]);
+	}
+	EXPECT_TRUE(queue.empty());
+	EXPECT_EQ(queue.next(), nullptr);
+}
+
+TEST(CalendarQueue, BitmapSparseWrapTest) {
+	// Many days, few events, with events in later years to force a wrap
+	BitmapQueue queue(16, 12);
+
+	uint64_t year = 1ull << queue.year;
+	queue.push(TestEvent(3u*year + 7u, "Later"));
+	queue.push(TestEvent(year - 1u, "EndOfYear"));
+	queue.push(TestEvent(5u, "Early"));
+
+	EXPECT_EQ(queue.next(6u)->value.name, "EndOfYear");
+
+	EXPECT_EQ(queue.pop().name, "Early");
+	EXPECT_EQ(queue.pop().name, "EndOfYear");
+	EXPECT_EQ(queue.pop().name, "Later");
+	EXPECT_TRUE(queue.empty());
+}
+
+TEST(CalendarQueue, BitmapResizeTest) {
+	BitmapQueue queue(8, 2);
+
+	uint64_t original_days = queue.days();
+	for (uint64_t i = 0u; i < 600u; i++) {
+		queue.push(TestEvent(i * 100u, "Event" + std::to_string(i)));
+	}
+	EXPECT_GT(queue.days(), original_days);
+	uint64_t grown_days = queue.days();
+
+	for (uint64_t i = 0u; i < 590u; i++) {
+		EXPECT_EQ(queue.pop().time, i * 100u);
+	}
+	EXPECT_LT(queue.days(), grown_days);
+
+	for (uint64_t i = 590u; i < 600u; i++) {
+		EXPECT_EQ(queue.pop().time, i * 100u);
+	}
+	EXPECT_TRUE(queue.empty());
+}
+
+/******************************************************************************
+ * EVENT STORAGE TESTS
+ *****************************************************************************/
+
+using ArenaQueue = calendar_queue<TestEvent, TestEventPriority, day_bitmap, arena_events<TestEvent> >;
+
+TEST(CalendarQueue, CopyQueueTest) {
+	TestQueue queue(8, 2);
+	for (uint64_t i = 0u; i < 100u; i++) {
+		addEvent(&queue, (i * 37u) % 1000u, "Event" + std::to_string(i));
+	}
+	// Leave some events on the unused list
+	for (int i = 0; i < 10; i++) {
+		queue.pop();
+	}
+
+	TestQueue copy(queue);
+	EXPECT_EQ(copy.count, queue.count);
+
+	// The copy must not share any events with the original
+	TestQueue::event *e = copy.next();
+	ASSERT_NE(e, nullptr);
+	EXPECT_NE(e, queue.next());
+	e->value.name = "Modified";
+	EXPECT_NE(queue.next()->value.name, "Modified");
+
+	// Both queues produce the same sequence
+	while (not queue.empty()) {
+		ASSERT_FALSE(copy.empty());
+		EXPECT_EQ(copy.pop().time, queue.pop().time);
+	}
+	EXPECT_TRUE(copy.empty());
+}
+
+TEST(CalendarQueue, AssignQueueTest) {
+	TestQueue copy(8, 2);
+	addEvent(&copy, 5u, "Replaced");
+
+	std::vector<uint64_t> times;
+	{
+		TestQueue queue(8, 2);
+		for (uint64_t i = 0u; i < 100u; i++) {
+			times.push_back((i * 37u) % 1000u);
+			addEvent(&queue, times.back(), "Event" + std::to_string(i));
+		}
+		copy = queue;
+	}
+
+	// The assigned queue must not point into the destroyed one
+	std::sort(times.begin(), times.end());
+	for (size_t i = 0; i < times.size(); i++) {
+		ASSERT_FALSE(copy.empty());
+		EXPECT_EQ(copy.pop().time, times[i]);
+	}
+	EXPECT_TRUE(copy.empty());
+}
+
+TEST(CalendarQueue, ArenaRandomOrderTest) {
+	ArenaQueue queue(8, 2);
+
+	std::mt19937 g(7);
+	std::uniform_int_distribution<uint64_t> dist(0u, 1u << 14);
+	std::vector<uint64_t> times;
+	for (int i = 0; i < 2000; i++) {
+		times.push_back(dist(g));
+		queue.push(TestEvent(times.back(), "Event" + std::to_string(i)));
+	}
+	std::sort(times.begin(), times.end());
+
+	for (size_t i = 0; i < times.size(); i++) {
+		ASSERT_FALSE(queue.empty());
+		EXPECT_EQ(queue.pop().time, times[i]);
+	}
+	EXPECT_TRUE(queue.empty());
+	EXPECT_EQ(queue.next(), ArenaQueue::nil);
+}
+
+TEST(CalendarQueue, ArenaHandleStabilityTest) {
+	ArenaQueue queue(8, 2);
+
+	// Handles are indices, so they survive reallocation of the arena
+	ArenaQueue::handle first = queue.push(TestEvent(500u, "First"));
+	ArenaQueue::handle middle = queue.push(TestEvent(250u, "Middle"));
+	for (uint64_t i = 0u; i < 1000u; i++) {
+		queue.push(TestEvent(1000u + i, "Filler"));
+	}
+	EXPECT_EQ(queue[first].value.name, "First");
+	EXPECT_EQ(queue[middle].value.name, "Middle");
+
+	TestEvent removed = queue.pop(middle);
+	EXPECT_EQ(removed.name, "Middle");
+	EXPECT_EQ(queue.pop().name, "First");
+}
+
+TEST(CalendarQueue, ArenaRecyclingTest) {
+	ArenaQueue queue(8, 2);
+
+	for (uint64_t i = 0u; i < 100u; i++) {
+		queue.push(TestEvent(i * 100u, "RecycleEvent"));
+	}
+	while (not queue.empty()) {
+		queue.pop();
+	}
+
+	size_t events_size_before = queue.events.size();
+	for (uint64_t i = 0u; i < 50u; i++) {
+		queue.push(TestEvent(i * 200u, "NewEvent"));
+	}
+	EXPECT_EQ(queue.events.size(), events_size_before);
+
+	uint64_t prev_time = 0u;
+	while (not queue.empty()) {
+		TestEvent e = queue.pop();
+		EXPECT_GE(e.time, prev_time);
+		prev_time = e.time;
+	}
+}
+
+TEST(CalendarQueue, ArenaCopyQueueTest) {
+	ArenaQueue queue(8, 2);
+	for (uint64_t i = 0u; i < 600u; i++) {
+		queue.push(TestEvent((i * 7919u) % 5000u, "Event"));
+	}
+
+	// Copies are a plain copy of the arena and calendar
+	ArenaQueue copy(queue);
+	while (not queue.empty()) {
+		ASSERT_FALSE(copy.empty());
+		EXPECT_EQ(copy.pop().time, queue.pop().time);
+	}
+	EXPECT_TRUE(copy.empty());
+}
+
+/******************************************************************************
+ * BATCH INSERTION TESTS
+ *****************************************************************************/
+
+TEST(CalendarQueue, PushBatchHandleOrderTest) {
+	TestQueue queue(8, 2);
+
+	std::vector<TestEvent> batch;
+	batch.push_back(TestEvent(300u, "C"));
+	batch.push_back(TestEvent(100u, "A"));
+	batch.push_back(TestEvent(200u, "B"));
+
+	std::vector<TestQueue::event*> handles = queue.push_batch(batch.begin(), batch.end());
+	ASSERT_EQ(handles.size(), 3u);
+	EXPECT_EQ(handles[0]->value.name, "C");
+	EXPECT_EQ(handles[1]->value.name, "A");
+	EXPECT_EQ(handles[2]->value.name, "B");
+	EXPECT_EQ(queue.count, 3u);
+	EXPECT_EQ(queue.now, 100u);
+
+	EXPECT_EQ(queue.pop().name, "A");
+	EXPECT_EQ(queue.pop().name, "B");
+	EXPECT_EQ(queue.pop().name, "C");
+	EXPECT_TRUE(queue.empty());
+}
+
+TEST(CalendarQueue, PushBatchMergeTest) {
+	ArenaQueue queue(8, 2);
+
+	// Existing events interleaved with the batch, in the same and other years
+	std::vector<uint64_t> times;
+	for (uint64_t i = 0u; i < 50u; i++) {
+		times.push_back(i * 97u);
+		queue.push(TestEvent(times.back(), "Single"));
+	}
+
+	std::mt19937 g(3);
+	std::uniform_int_distribution<uint64_t> dist(0u, 1u << 10);
+	std::vector<TestEvent> batch;
+	for (int i = 0; i < 60; i++) {
+		batch.push_back(TestEvent(dist(g), "Batch" + std::to_string(i)));
+		times.push_back(batch.back().time);
+	}
+
+	std::vector<ArenaQueue::handle> handles = queue.push_batch(batch.begin(), batch.end());
+	ASSERT_EQ(handles.size(), batch.size());
+	for (size_t i = 0; i < handles.size(); i++) {
+		EXPECT_EQ(queue[handles[i]].value.name, batch[i].name);
+	}
+	EXPECT_EQ(queue.count, times.size());
+
+	// Removing a batched event by handle works like any other event
+	EXPECT_EQ(queue.pop(handles[5]).name, "Batch5");
+	times.erase(std::find(times.begin(), times.end(), batch[5].time));
+
+	std::sort(times.begin(), times.end());
+	for (size_t i = 0; i < times.size(); i++) {
+		ASSERT_FALSE(queue.empty());
+		EXPECT_EQ(queue.pop().time, times[i]);
+	}
+	EXPECT_TRUE(queue.empty());
+}
+
+TEST(CalendarQueue, PushBatchEqualKeysTest) {
+	TestQueue queue(8, 2);
+	TestQueue single(8, 2);
+
+	// Events at the same time go ahead of those already queued, whether they
+	// are pushed one at a time or in a batch
+	std::vector<TestEvent> batch;
+	batch.push_back(TestEvent(100u, "B0"));
+	batch.push_back(TestEvent(200u, "B1"));
+	batch.push_back(TestEvent(100u, "B2"));
+	for (int i = 0; i < 2; i++) {
+		addEvent(&queue, 100u, "S" + std::to_string(i));
+		addEvent(&single, 100u, "S" + std::to_string(i));
+	}
+	queue.push_batch(batch.begin(), batch.end());
+	for (auto e = batch.begin(); e != batch.end(); e++) {
+		single.push(*e);
+	}
+
+	std::vector<std::string> expect = {"B2", "B0", "S1", "S0", "B1"};
+	for (size_t i = 0; i < expect.size(); i++) {
+		ASSERT_FALSE(queue.empty());
+		EXPECT_EQ(queue.pop().name, expect[i]);
+		EXPECT_EQ(single.pop().name, expect[i]);
+	}
+	EXPECT_TRUE(queue.empty());
+	EXPECT_TRUE(single.empty());
+}
+
+TEST(CalendarQueue, PushBatchSingleResizeTest) {
+	TestQueue queue(8, 2);
+	uint64_t original_day = queue.day;
+
+	std::vector<TestEvent> batch;
+	for (uint64_t i = 0u; i < 600u; i++) {
+		batch.push_back(TestEvent(i * 100u, "Event" + std::to_string(i)));
+	}
+	queue.push_batch(batch.begin(), batch.end());
+
+	// Only one resize happens for the whole batch
+	EXPECT_EQ(queue.day, (int)original_day-1);
+	EXPECT_EQ(queue.count, 600u);
+	verifyQueueOrder(&queue);
+}
+
+/******************************************************************************
+ * LAZY CANCELLATION TESTS
+ *****************************************************************************/
+
+TEST(CalendarQueue, CancelSkipsTombstoneTest) {
+	TestQueue queue(8, 2);
+
+	addEvent(&queue, 100u, "Event1");
+	TestQueue::event *middle = addEvent(&queue, 200u, "Event2");
+	addEvent(&queue, 300u, "Event3");
+
+	uint32_t gen = middle->gen;
+	queue.cancel(middle);
+	EXPECT_TRUE(queue.dead(middle));
+	EXPECT_NE(middle->gen, gen);
+	EXPECT_EQ(queue.size(), 2u);
+	EXPECT_EQ(queue.tombs, 1u);
+
+	// Cancelling twice has no effect
+	queue.cancel(middle);
+	EXPECT_EQ(queue.tombs, 1u);
+
+	EXPECT_EQ(queue.pop().name, "Event1");
+	EXPECT_EQ(queue.pop().name, "Event3");
+	EXPECT_TRUE(queue.empty());
+	EXPECT_EQ(queue.next(), nullptr);
+}
+
+TEST(CalendarQueue, CancelCompactionTest) {
+	ArenaQueue queue(8, 2);
+
+	std::vector<ArenaQueue::handle> handles;
+	for (uint64_t i = 0u; i < 100u; i++) {
+		handles.push_back(queue.push(TestEvent(i * 10u, "Event" + std::to_string(i))));
+	}
+
+	// Cancelling more than half of the linked events compacts them away
+	for (uint64_t i = 0u; i < 100u; i += 2u) {
+		queue.cancel(handles[i]);
+	}
+	queue.cancel(handles[1]);
+	EXPECT_EQ(queue.tombs, 0u);
+	EXPECT_EQ(queue.count, 49u);
+	EXPECT_EQ(queue.size(), 49u);
+
+	for (uint64_t i = 3u; i < 100u; i += 2u) {
+		EXPECT_EQ(queue.pop().time, i * 10u);
+	}
+	EXPECT_TRUE(queue.empty());
+}
+
+TEST(CalendarQueue, CancelResizeTest) {
+	TestQueue queue(8, 2);
+
+	std::vector<TestQueue::event*> handles;
+	for (uint64_t i = 0u; i < 600u; i++) {
+		handles.push_back(addEvent(&queue, i * 100u, "Event" + std::to_string(i)));
+	}
+	uint64_t grown_days = queue.days();
+
+	// Tombstones are dropped when the calendar is resized
+	for (uint64_t i = 0u; i < 290u; i++) {
+		queue.cancel(handles[i*2u]);
+	}
+	EXPECT_EQ(queue.tombs, 290u);
+	for (uint64_t i = 0u; i < 250u; i++) {
+		EXPECT_EQ(queue.pop().time, (i*2u+1u) * 100u);
+	}
+	EXPECT_LT(queue.days(), grown_days);
+	EXPECT_EQ(queue.tombs, 0u);
+	EXPECT_EQ(queue.size(), 60u);
+	verifyQueueOrder(&queue);
+}
+
+TEST(CalendarQueue, CancelAndRescheduleTest) {
+	ArenaQueue queue(10, 4);
+
+	std::mt19937 g(11);
+	std::uniform_int_distribution<uint64_t> delay(1u, 1u << 12);
+	std::vector<ArenaQueue::handle> handles(32, ArenaQueue::nil);
+	std::vector<uint64_t> times(32, 0u);
+	for (int i = 0; i < 32; i++) {
+		times[i] = delay(g);
+		handles[i] = queue.push(TestEvent(times[i], std::to_string(i)));
+	}
+
+	// Cancel and reschedule events at random, checking the popped order
+	uint64_t now = 0u;
+	for (int i = 0; i < 2000; i++) {
+		if (i%3 == 0) {
+			TestEvent e = queue.pop();
+			EXPECT_GE(e.time, now);
+			int id = std::stoi(e.name);
+			EXPECT_EQ(e.time, times[id]);
+			now = e.time;
+			times[id] = now + delay(g);
+			handles[id] = queue.push(TestEvent(times[id], e.name));
+		} else {
+			int id = (int)(delay(g)%32u);
+			queue.cancel(handles[id]);
+			times[id] = now + delay(g);
+			handles[id] = queue.push(TestEvent(times[id], std::to_string(id)));
+		}
+		EXPECT_EQ(queue.size(), 32u);
+	}
+}
+
+/******************************************************************************
+ * RESIZE POLICY TESTS
+ *****************************************************************************/
+
+// Push and pop in waves so that the population swings between 3 and 9 events
+template <typename Q>
+void oscillate(Q *queue, int cycles) {
+	uint64_t now = 0u;
+	for (int i = 0; i < 3; i++) {
+		queue->push(TestEvent(now + i, "Base"));
+	}
+	for (int c = 0; c < cycles; c++) {
+		for (int i = 0; i < 6; i++) {
+			queue->push(TestEvent(now + 10u + i, "Wave"));
+		}
+		for (int i = 0; i < 6; i++) {
+			TestEvent e = queue->pop();
+			EXPECT_GE(e.time, now);
+			now = e.time;
+		}
+	}
+}
+
+TEST(CalendarQueue, ResizeHysteresisTest) {
+	// Default policy: grow above 2 events per day, shrink below 1/2
+	TestQueue thrash(10, 2);
+	oscillate(&thrash, 20);
+	EXPECT_GE(thrash.grows, 20u);
+	EXPECT_GE(thrash.shrinks, 19u);
+
+	// A wider band absorbs the same swings without resizing
+	TestQueue damped(10, 2, TestEventPriority(), resize_policy(2, 2));
+	oscillate(&damped, 20);
+	EXPECT_EQ(damped.grows, 0u);
+	EXPECT_EQ(damped.shrinks, 0u);
+	EXPECT_EQ(damped.size(), thrash.size());
+}
+
+TEST(CalendarQueue, IncrementalResizeOrderTest) {
+	ArenaQueue queue(10, 2, TestEventPriority(), resize_policy(1, 1, 1));
+
+	std::mt19937 g(5);
+	std::uniform_int_distribution<uint64_t> delay(1u, 1u << 11);
+	std::multiset<uint64_t> expect;
+	std::map<int, ArenaQueue::handle> live;
+	int id = 0;
+
+	// Grow well past the initial calendar and back down again, checking the
+	// order of everything popped while migrations are in progress
+	bool migrating = false;
+	uint64_t now = 0u;
+	for (int phase = 0; phase < 2; phase++) {
+		for (int i = 0; i < 3000; i++) {
+			bool fill = (phase == 0 ? i%4 != 0 : i%4 == 0);
+			if (fill or expect.empty()) {
+				uint64_t t = now + delay(g);
+				live[id] = queue.push(TestEvent(t, std::to_string(id)));
+				expect.insert(t);
+				id++;
+			} else if (i%7 == 0) {
+				// cancel a random event
+				auto j = live.lower_bound((int)(delay(g)%id));
+				if (j == live.end()) {
+					j = live.begin();
+				}
+				expect.erase(expect.find(queue.events[j->second].value.time));
+				queue.cancel(j->second);
+				live.erase(j);
+			} else {
+				TestEvent e = queue.pop();
+				EXPECT_EQ(e.time, *expect.begin());
+				expect.erase(expect.begin());
+				live.erase(std::stoi(e.name));
+				now = e.time;
+			}
+			migrating = migrating or not queue.old.empty();
+			EXPECT_EQ(queue.size(), expect.size());
+		}
+	}
+
+	EXPECT_TRUE(migrating);
+	EXPECT_GT(queue.grows, 0u);
+	EXPECT_GT(queue.shrinks, 0u);
+	while (not expect.empty()) {
+		EXPECT_EQ(queue.pop().time, *expect.begin());
+		expect.erase(expect.begin());
+	}
+	EXPECT_TRUE(queue.empty());
+}
+
+TEST(CalendarQueue, IncrementalResizeCopyTest) {
+	TestQueue queue(8, 2, TestEventPriority(), resize_policy(1, 1, 1));
+
+	for (uint64_t i = 0u; i < 9u; i++) {
+		queue.push(TestEvent(i * 37u, "Event" + std::to_string(i)));
+	}
+	ASSERT_FALSE(queue.old.empty());
+
+	// A copy taken mid-migration pops the same sequence as the original
+	TestQueue copy(queue);
+	for (uint64_t i = 0u; i < 9u; i++) {
+		TestEvent e0 = queue.pop();
+		TestEvent e1 = copy.pop();
+		EXPECT_EQ(e0.time, i * 37u);
+		EXPECT_EQ(e1.time, i * 37u);
+		EXPECT_EQ(e0.name, e1.name);
+	}
+	EXPECT_TRUE(queue.empty());
+	EXPECT_TRUE(copy.empty());
+}
+
+/******************************************************************************
+ * ADAPTIVE DAY WIDTH TESTS
+ *****************************************************************************/
+
+// Pop the earliest event and reschedule it a random delay into the future,
+// checking the order of every event popped
+template <typename Q>
+void churnDelays(Q *queue, int population, int iterations, uint64_t max_delay) {
+	std::mt19937 g(17);
+	std::uniform_int_distribution<uint64_t> delay(1u, max_delay);
+	std::multiset<uint64_t> expect;
+	for (int i = 0; i < population; i++) {
+		uint64_t t = delay(g);
+		queue->push(TestEvent(t, "Event"));
+		expect.insert(t);
+	}
+	for (int i = 0; i < iterations; i++) {
+		TestEvent e = queue->pop();
+		ASSERT_EQ(e.time, *expect.begin());
+		expect.erase(expect.begin());
+		uint64_t t = e.time + delay(g);
+		queue->push(TestEvent(t, e.name));
+		expect.insert(t);
+	}
+	EXPECT_EQ(queue->size(), (uint64_t)population);
+}
+
+TEST(CalendarQueue, AdaptiveNarrowDaysTest) {
+	// With the defaults every event lands in a single 1024 wide day
+	ArenaQueue queue(14, 4, TestEventPriority(), resize_policy(1, 1, 0, true));
+	churnDelays(&queue, 200, 5000, 16u);
+
+	// 200 events spread over 16 ticks are about 1/12 apart, so days shrink
+	// to a single tick and the year stretches to hold them
+	EXPECT_EQ(queue.day, 0);
+	EXPECT_GE(queue.days(), 200u);
+	EXPECT_GT(queue.retunes, 0u);
+}
+
+TEST(CalendarQueue, AdaptiveWideDaysTest) {
+	ArenaQueue queue(14, 4, TestEventPriority(), resize_policy(1, 1, 0, true));
+	churnDelays(&queue, 100, 5000, 1u << 24);
+
+	// 100 events spread over 2^24 are about 2^17 apart, so days widen to
+	// about 2^18 instead of wrapping the 2^14 year a thousand times
+	EXPECT_GE(queue.day, 17);
+	EXPECT_LE(queue.day, 19);
+	EXPECT_GE(queue.days(), 100u);
+}
+
+TEST(CalendarQueue, AdaptiveIncrementalTest) {
+	// Retuning through an incremental migration keeps the order intact
+	ArenaQueue queue(14, 4, TestEventPriority(), resize_policy(1, 1, 2, true));
+	churnDelays(&queue, 300, 4000, 1u << 20);
+	EXPECT_GT(queue.retunes, 0u);
+
+	queue.clear();
+	EXPECT_TRUE(queue.empty());
+	EXPECT_EQ(queue.year - queue.day, 4);
+	churnDelays(&queue, 50, 2000, 1u << 6);
+}
@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+#include <prs/production_rule.h>
+#include <prs/simulator.h>
+#include <prs/counters.h>
+#include "helpers.h"
+
+using namespace prs;
+using namespace test;
+
+// With PRS_COUNTERS, each fired event is counted against its net, and every
+// evaluation models at least one device. Without it nothing is counted.
+TEST(CountersTest, CountsRing) {
+	int enable;
+	vector<int> probe;
+	production_rule_set prs = coupled_rings(2, enable, probe);
+
+	simulator sim(&prs);
+	sim.reset();
+	sim.set(enable, 0);
+	while (not sim.enabled.empty()) {
+		sim.fire();
+	}
+	sim.set(enable, 1);
+	sim.counters.clear();
+	for (int i = 0; i < 1000; i++) {
+		sim.fire();
+	}
+
+#ifdef PRS_COUNTERS
+	EXPECT_EQ(sim.counters.fired, 1000u);
+	uint64_t fired = 0;
+	for (auto c = sim.counters.net_fired.begin(); c != sim.counters.net_fired.end(); c++) {
+		fired += *c;
+	}
+	EXPECT_EQ(fired, 1000u);
+	EXPECT_GE(sim.counters.scheduled, sim.counters.fired);
+	EXPECT_GT(sim.counters.evaluations, 0u);
+	EXPECT_GE(sim.counters.worklist_total, sim.counters.evaluations);
+
+	uint64_t modeled = 0;
+	for (auto c = sim.counters.dev_modeled.begin(); c != sim.counters.dev_modeled.end(); c++) {
+		modeled += *c;
+	}
+	EXPECT_GE(modeled, sim.counters.evaluations);
+	EXPECT_NE(sim.counters.to_string(&prs).find("fired 1000"), string::npos);
+	EXPECT_NE(sim.counters.nets_to_string(&prs).find(prs.netAt(probe[0])), string::npos);
+#else
+	EXPECT_EQ(sim.counters.fired, 0u);
+	EXPECT_EQ(sim.counters.scheduled, 0u);
+	EXPECT_TRUE(sim.counters.dev_modeled.empty());
+#endif
+}
@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+#include <prs/delay_model.h>
+#include <vector>
+
+using namespace prs;
+using std::vector;
+
+// The same seed gives the same stream, and reseeding restarts it
+TEST(DelayModelTest, Reproducible) {
+	delay_model a(delay_model::pareto, 42);
+	delay_model b(delay_model::pareto, 42);
+	delay_model c(delay_model::pareto, 43);
+
+	vector<uint64_t> first;
+	bool differs = false;
+	for (int i = 0; i < 100; i++) {
+		uint64_t d = a.sample(1000);
+		EXPECT_EQ(d, b.sample(1000));
+		differs = differs or d != c.sample(1000);
+		first.push_back(d);
+	}
+	EXPECT_TRUE(differs);
+
+	a.reseed();
+	for (int i = 0; i < 100; i++) {
+		EXPECT_EQ(a.sample(1000), first[i]);
+	}
+}
+
+TEST(DelayModelTest, Bounds) {
+	delay_model pareto(delay_model::pareto, 1);
+	delay_model uniform(delay_model::uniform, 1);
+	for (int i = 0; i < 10000; i++) {
+		EXPECT_GE(pareto.sample(1000), 1000u);
+		uint64_t d = uniform.sample(1000);
+		EXPECT_GE(d, 500u);
+		EXPECT_LE(d, 1000u);
+	}
+
+	delay_model fixed_max(delay_model::fixed_max);
+	delay_model fixed_min(delay_model::fixed_min);
+	EXPECT_EQ(fixed_max.sample(1000), 1000u);
+	EXPECT_EQ(fixed_min.sample(1000), 500u);
+	EXPECT_EQ(pareto.sample(0), 0u);
+	EXPECT_EQ(uniform.sample(0), 0u);
+}
+
+// Uniform draws fill [0, 1) evenly
+TEST(DelayModelTest, UniformMean) {
+	xoshiro256 rng(7);
+	double sum = 0.0;
+	const int n = 100000;
+	for (int i = 0; i < n; i++) {
+		double u = rng.uniform();
+		ASSERT_GE(u, 0.0);
+		ASSERT_LT(u, 1.0);
+		sum += u;
+	}
+	EXPECT_NEAR(sum/n, 0.5, 0.01);
+}
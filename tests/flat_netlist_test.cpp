@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+#include <prs/production_rule.h>
+#include <prs/flat_netlist.h>
+#include "helpers.h"
+
+using namespace prs;
+using namespace test;
+
+static vector<int> as_vector(span<const int> s) {
+	return vector<int>(s.begin(), s.end());
+}
+
+// Every adjacency list and packed field matches the production rule set it
+// was compiled from
+TEST(FlatNetlistTest, MatchesProductionRuleSet) {
+	string prs_str = R"(
+a&b->x-
+~a|~b->x+
+x->y-
+~x->y+
+~y->x+ [weak]
+)";
+
+	production_rule_set prs = parse_prs_string(prs_str);
+	flat_netlist flat(prs);
+
+	ASSERT_EQ(flat.size(), (int)prs.nets.size());
+	ASSERT_EQ(flat.devs.size(), prs.devs.size());
+	for (int i = 0; i < (int)prs.nets.size(); i++) {
+		for (int k = 0; k < 2; k++) {
+			EXPECT_EQ(as_vector(flat.gateOf(i, k)), prs.nets[i].gateOf[k]);
+			EXPECT_EQ(as_vector(flat.sourceOf(i, k)), prs.nets[i].sourceOf[k]);
+			EXPECT_EQ(as_vector(flat.drainOf(i, k)), prs.nets[i].drainOf[k]);
+		}
+		EXPECT_EQ(as_vector(flat.remote(i)), prs.nets[i].remote);
+		EXPECT_EQ(flat.nets[i].keep, prs.nets[i].keep);
+		EXPECT_EQ(flat.nets[i].node, prs.nets[i].isNode());
+		EXPECT_EQ(flat.nets[i].driver, prs.nets[i].driver);
+	}
+
+	for (int i = 0; i < (int)prs.devs.size(); i++) {
+		EXPECT_EQ(flat.devs[i].source, prs.devs[i].source);
+		EXPECT_EQ(flat.devs[i].gate, prs.devs[i].gate);
+		EXPECT_EQ(flat.devs[i].drain, prs.devs[i].drain);
+		EXPECT_EQ(flat.devs[i].threshold, prs.devs[i].threshold);
+		EXPECT_EQ(flat.devs[i].driver, prs.devs[i].driver);
+		EXPECT_EQ(flat.devs[i].weak, prs.devs[i].attr.weak);
+		EXPECT_EQ(flat.devs[i].delay_max, prs.devs[i].attr.delay_max);
+	}
+}
+
+// A view is only out of date once the production rule set changes
+TEST(FlatNetlistTest, MatchesDetectsChanges) {
+	string prs_str = R"(
+a&b->x-
+~a|~b->x+
+x->y-
+~x->y+
+)";
+
+	production_rule_set prs = parse_prs_string(prs_str);
+	flat_netlist flat(prs);
+	EXPECT_TRUE(flat.matches(prs));
+
+	prs.devs[0].attr.delay_max += 100;
+	EXPECT_FALSE(flat.matches(prs));
+	flat = flat_netlist(prs);
+	EXPECT_TRUE(flat.matches(prs));
+
+	prs.devs[0].gate = prs.netIndex("y");
+	EXPECT_FALSE(flat.matches(prs));
+	flat = flat_netlist(prs);
+
+	prs.create(net(string("z")));
+	EXPECT_FALSE(flat.matches(prs));
+}
+
+TEST(FlatNetlistTest, EmptySet) {
+	production_rule_set prs;
+	flat_netlist flat(prs);
+	EXPECT_EQ(flat.size(), 0);
+	EXPECT_TRUE(flat.devs.empty());
+}
+
+// connect_remote() only updates the lists of the two nets it connects, so
+// the remote groups are closed over every list before they are compiled
+TEST(FlatNetlistTest, RemoteGroupsAreClosed) {
+	production_rule_set prs;
+	int a = prs.create(net(string("a")));
+	int b = prs.create(net(string("b")));
+	int c = prs.create(net(string("c")));
+	int d = prs.create(net(string("d")));
+	prs.connect_remote(a, b);
+	prs.connect_remote(b, c);
+
+	vector<vector<int> > groups = prs.remote_groups();
+	ASSERT_EQ(groups.size(), 2u);
+	EXPECT_EQ(groups[0], vector<int>({a, b, c}));
+	EXPECT_EQ(groups[1], vector<int>({d}));
+
+	flat_netlist flat(prs);
+	EXPECT_EQ(as_vector(flat.remote(a)), vector<int>({a, b, c}));
+	EXPECT_EQ(as_vector(flat.remote(c)), vector<int>({a, b, c}));
+	EXPECT_EQ(as_vector(flat.remote(d)), vector<int>({d}));
+}
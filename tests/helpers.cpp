@@ -95,4 +95,72 @@ phy::Tech create_test_tech() {
     return tech;
 }
 
+// One five stage ring oscillator per region, each with its own delay. Stage
+// zero of each ring is a NAND of the enable, its last stage, and the middle
+// stage of the ring in the previous region, so that changes cross between
+// regions.
+prs::production_rule_set coupled_rings(int regions, int &enable, std::vector<int> &probe) {
+	using namespace prs;
+	production_rule_set pr;
+	int vdd = pr.create(net("Vdd", 0, true, true));
+	int gnd = pr.create(net("GND", 0, true, true));
+	pr.set_power(vdd, gnd);
+	enable = pr.netIndex("en", true);
+
+	string tap;
+	for (int r = 0; r < regions; r++) {
+		attributes attr;
+		attr.delay_max = 1000 + 137*r;
+
+		string suffix = "'" + std::to_string(r);
+		int en = pr.netIndex("en" + suffix, true);
+		vector<int> x;
+		for (int i = 0; i < 5; i++) {
+			x.push_back(pr.netIndex("x" + std::to_string(r) + "_" + std::to_string(i) + suffix, true));
+		}
+
+		boolean::cube pulldown = boolean::cube(en, 1) & boolean::cube(x[4], 1);
+		boolean::cover pullup = boolean::cover(en, 0) | boolean::cover(x[4], 0);
+		if (not tap.empty()) {
+			int t = pr.netIndex(tap + suffix, true);
+			pulldown &= boolean::cube(t, 1);
+			pullup |= boolean::cover(t, 0);
+		}
+		pr.add(gnd, boolean::cover(pulldown), x[0], 0, attr);
+		pr.add(vdd, pullup, x[0], 1, attr);
+		for (int i = 1; i < 5; i++) {
+			pr.add(gnd, boolean::cover(x[i-1], 1), x[i], 0, attr);
+			pr.add(vdd, boolean::cover(x[i-1], 0), x[i], 1, attr);
+		}
+
+		tap = "x" + std::to_string(r) + "_2";
+		probe.insert(probe.end(), x.begin(), x.end());
+	}
+	return pr;
+}
+
+prs::production_rule_set simultaneous_regions(int &x, int &y, std::vector<int> &probe) {
+	using namespace prs;
+	production_rule_set pr;
+	int vdd = pr.create(net("Vdd", 0, true, true));
+	int gnd = pr.create(net("GND", 0, true, true));
+	pr.set_power(vdd, gnd);
+
+	x = pr.netIndex("x", true);
+	int a = pr.netIndex("a", true);
+	y = pr.netIndex("y'1", true);
+	int copy = pr.netIndex("a'1", true);
+	int b = pr.netIndex("b'1", true);
+
+	attributes attr;
+	attr.delay_max = 1000;
+	pr.add(gnd, boolean::cover(x, 1), a, 0, attr);
+	pr.add(vdd, boolean::cover(x, 0), a, 1, attr);
+	pr.add(gnd, boolean::cover(boolean::cube(copy, 1) & boolean::cube(y, 1)), b, 0, attr);
+	pr.add(vdd, boolean::cover(copy, 0) | boolean::cover(y, 0), b, 1, attr);
+
+	probe = std::vector<int>({a, copy, b});
+	return pr;
+}
+
 }
@@ -18,4 +18,15 @@ prs::production_rule_set parse_prs_string(const std::string &prs_str);
 // Helper function to create a minimal Tech structure for testing PRS
 phy::Tech create_test_tech();
 
+// One five stage ring oscillator per region, each with its own delay, with
+// stage zero of each ring also gated by a stage of the ring in the previous
+// region. probe lists the stages of every ring.
+prs::production_rule_set coupled_rings(int regions, int &enable, std::vector<int> &probe);
+
+// a follows ~x in region 0, and b is a NAND of a and y in region 1, all with
+// the same delay. Setting x and y together makes a and b fire at the same
+// time, with a changing the guard of b. probe lists a, its copy in region 1,
+// and b.
+prs::production_rule_set simultaneous_regions(int &x, int &y, std::vector<int> &probe);
+
 }
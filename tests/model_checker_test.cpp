@@ -0,0 +1,192 @@
+#include <gtest/gtest.h>
+#include <prs/production_rule.h>
+#include <prs/simulator.h>
+#include <prs/model_checker.h>
+#include <set>
+#include <thread>
+#include "helpers.h"
+
+using namespace prs;
+using namespace test;
+
+// Every fingerprint is counted once however many threads insert it
+TEST(StateSetTest, ConcurrentInsert) {
+	state_set set(12);
+	std::atomic<int> added(0);
+	vector<std::thread> pool;
+	for (int w = 0; w < 4; w++) {
+		pool.push_back(std::thread([&, w]() {
+			for (uint64_t i = 0; i < 1000; i++) {
+				added += (int)set.insert(i*0x9e3779b97f4a7c15ULL + (uint64_t)(w&1));
+			}
+		}));
+	}
+	for (auto t = pool.begin(); t != pool.end(); t++) {
+		t->join();
+	}
+	EXPECT_EQ(added, 2000);
+	EXPECT_EQ(set.count, 2000u);
+	EXPECT_FALSE(set.insert(0x9e3779b97f4a7c15ULL));
+	EXPECT_FALSE(set.full());
+}
+
+// When x rises before y falls, out is driven low and then released before
+// it fires
+TEST(ModelCheckerTest, FindsInstability) {
+	string prs_str = R"(
+	a->x-
+	~a->x+
+
+	a->y+
+	~a->y-
+
+	x&y->out-
+	~x|~y->out+
+	)";
+
+	production_rule_set prs = parse_prs_string(prs_str);
+	int vdd = prs.create(net("vdd"));
+	int gnd = prs.create(net("gnd"));
+	prs.set_power(vdd, gnd);
+
+	int a = prs.netIndex("a");
+	int x = prs.netIndex("x");
+	int out = prs.netIndex("out");
+
+	simulator sim(&prs);
+	sim.reset();
+	sim.set(a, 1, 3);
+	while (not sim.enabled.empty()) {
+		sim.fire();
+	}
+	sim.set(a, 0, 3);
+
+	model_checker checker(&prs, 12);
+	checker.deadlock = false;
+	checker.check(sim);
+	EXPECT_TRUE(checker.complete);
+
+	bool found = false;
+	for (auto e = checker.errors.begin(); e != checker.errors.end(); e++) {
+		if (e->kind == check_error::instability and e->net == out) {
+			found = true;
+			ASSERT_FALSE(e->trace.empty());
+			EXPECT_EQ(e->trace.front(), pair<int, int>(x, 1));
+			EXPECT_EQ(e->trace.back().first, out);
+		}
+	}
+	EXPECT_TRUE(found);
+}
+
+// Two independent inverters fire in either order to the same state, which
+// the reduction reaches through one order only
+TEST(ModelCheckerTest, ReducesIndependentTransitions) {
+	string prs_str = R"(
+	a->x-
+	~a->x+
+
+	b->y-
+	~b->y+
+	)";
+
+	production_rule_set prs = parse_prs_string(prs_str);
+	int vdd = prs.create(net("vdd"));
+	int gnd = prs.create(net("gnd"));
+	prs.set_power(vdd, gnd);
+
+	int a = prs.netIndex("a");
+	int b = prs.netIndex("b");
+
+	simulator sim(&prs);
+	sim.reset();
+	sim.set(a, 0, 3);
+	sim.set(b, 0, 3);
+	while (not sim.enabled.empty()) {
+		sim.fire();
+	}
+	sim.set(a, 1, 3);
+	sim.set(b, 1, 3);
+
+	model_checker full(&prs, 12);
+	full.reduce = false;
+	full.check(sim);
+	EXPECT_EQ(full.nodes.size(), 4u);
+
+	model_checker reduced(&prs, 12);
+	reduced.check(sim, 2);
+	EXPECT_EQ(reduced.nodes.size(), 3u);
+
+	// The settled state is the only one with nothing enabled
+	ASSERT_EQ(reduced.errors.size(), 1u);
+	EXPECT_EQ(reduced.errors[0].kind, check_error::deadlock);
+	EXPECT_EQ(reduced.errors[0].trace.size(), 2u);
+}
+
+// The reduction and the number of threads change how many states are
+// visited but not which problems are found
+TEST(ModelCheckerTest, ReductionKeepsErrors) {
+	int enable;
+	vector<int> probe;
+	production_rule_set prs = coupled_rings(2, enable, probe);
+
+	simulator sim(&prs);
+	sim.reset();
+	sim.set(enable, 0);
+	while (not sim.enabled.empty()) {
+		sim.fire();
+	}
+	sim.set(enable, 1);
+
+	auto problems = [](const model_checker &checker) {
+		std::set<pair<int, int> > result;
+		for (auto e = checker.errors.begin(); e != checker.errors.end(); e++) {
+			result.insert(pair<int, int>(e->kind, e->net));
+		}
+		return result;
+	};
+
+	model_checker full(&prs, 16);
+	full.reduce = false;
+	full.check(sim);
+	ASSERT_TRUE(full.complete);
+
+	model_checker reduced(&prs, 16);
+	reduced.check(sim);
+	ASSERT_TRUE(reduced.complete);
+	EXPECT_LE(reduced.nodes.size(), full.nodes.size());
+	EXPECT_EQ(problems(reduced), problems(full));
+
+	model_checker parallel(&prs, 16);
+	parallel.reduce = false;
+	parallel.check(sim, 3);
+	EXPECT_EQ(parallel.nodes.size(), full.nodes.size());
+	EXPECT_EQ(problems(parallel), problems(full));
+}
+
+// The cycle proviso only looks at states from earlier levels, so which
+// thread reaches a new state first does not change what is counted
+TEST(ModelCheckerTest, ReductionIgnoresThreads) {
+	int enable;
+	vector<int> probe;
+	production_rule_set prs = coupled_rings(2, enable, probe);
+
+	simulator sim(&prs);
+	sim.reset();
+	sim.set(enable, 0);
+	while (not sim.enabled.empty()) {
+		sim.fire();
+	}
+	sim.set(enable, 1);
+
+	model_checker single(&prs, 16);
+	single.check(sim);
+	ASSERT_TRUE(single.complete);
+
+	for (int i = 0; i < 4; i++) {
+		model_checker parallel(&prs, 16);
+		parallel.check(sim, 4);
+		ASSERT_TRUE(parallel.complete);
+		EXPECT_EQ(parallel.nodes.size(), single.nodes.size());
+		EXPECT_EQ(parallel.transitions.load(), single.transitions.load());
+	}
+}
@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+#include <prs/production_rule.h>
+#include <prs/simulator.h>
+#include <prs/monte_carlo.h>
+#include "helpers.h"
+
+using namespace prs;
+using namespace test;
+
+TEST(HistogramTest, BinsAndMerge) {
+	histogram a(100, 10, 4);
+	a.add(50);
+	a.add(100);
+	a.add(119);
+	a.add(139);
+	a.add(140);
+	EXPECT_EQ(a.under, 1u);
+	EXPECT_EQ(a.over, 1u);
+	EXPECT_EQ(a.bins, vector<uint64_t>({1, 1, 0, 1}));
+	EXPECT_EQ(a.min, 50u);
+	EXPECT_EQ(a.max, 140u);
+
+	histogram b(100, 10, 4);
+	b.add(125);
+	a.merge(b);
+	EXPECT_EQ(a.bins, vector<uint64_t>({1, 1, 1, 1}));
+	EXPECT_EQ(a.count, 6u);
+	EXPECT_DOUBLE_EQ(a.mean(), (50.0+100+119+139+140+125)/6.0);
+}
+
+// Start a ring with the enable low, then release it
+monte_carlo ring_sweep(const production_rule_set *prs, int enable, int probe) {
+	monte_carlo mc(prs);
+	mc.stimulus.push_back(stimulus_step(0, enable, 0));
+	mc.stimulus.push_back(stimulus_step(20000, enable, 1));
+	mc.probes.push_back(pair<int, int>(probe, 1));
+	mc.until = 200000;
+	return mc;
+}
+
+// With fixed delays every run sees the ten stage delays of the ring
+TEST(MonteCarloTest, FixedPeriod) {
+	int enable;
+	vector<int> probe;
+	production_rule_set prs = coupled_rings(1, enable, probe);
+
+	monte_carlo mc = ring_sweep(&prs, enable, probe[0]);
+	mc.delay.policy = delay_model::fixed_max;
+	mc.sweep(4, 2);
+
+	ASSERT_EQ((int)mc.runs.size(), 4);
+	for (auto r = mc.runs.begin(); r != mc.runs.end(); r++) {
+		EXPECT_GT(r->changes, 1u);
+		EXPECT_DOUBLE_EQ(r->period, 10000.0);
+		EXPECT_EQ(r->unstable, 0u);
+		EXPECT_EQ(r->interference, 0u);
+	}
+	EXPECT_EQ(mc.period.min, 10000u);
+	EXPECT_EQ(mc.period.max, 10000u);
+	EXPECT_EQ(mc.unstable.count, 4u);
+}
+
+// Each run depends only on its seed, whatever the number of threads
+TEST(MonteCarloTest, ReproducibleAcrossThreads) {
+	int enable;
+	vector<int> probe;
+	production_rule_set prs = coupled_rings(1, enable, probe);
+
+	monte_carlo one = ring_sweep(&prs, enable, probe[0]);
+	one.sweep(16, 1, 7);
+	monte_carlo many = ring_sweep(&prs, enable, probe[0]);
+	many.sweep(16, 4, 7);
+
+	bool differs = false;
+	for (int i = 0; i < 16; i++) {
+		EXPECT_EQ(one.runs[i].seed, 7u + i);
+		EXPECT_EQ(one.runs[i].events, many.runs[i].events);
+		EXPECT_EQ(one.runs[i].changes, many.runs[i].changes);
+		EXPECT_DOUBLE_EQ(one.runs[i].period, many.runs[i].period);
+		EXPECT_GE(one.runs[i].period, 10000.0);
+		differs = differs or one.runs[i].period != one.runs[0].period;
+	}
+	EXPECT_TRUE(differs);
+	EXPECT_EQ(one.period.bins, many.period.bins);
+	EXPECT_EQ(one.period.count, many.period.count);
+}
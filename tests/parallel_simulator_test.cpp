@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+#include <prs/production_rule.h>
+#include <prs/simulator.h>
+#include <prs/parallel_simulator.h>
+#include "helpers.h"
+
+using namespace prs;
+using namespace test;
+
+// Each lane gets its own inputs, and every lane settles to the truth table
+template <typename S>
+void checkNandTable() {
+	string prs_str = R"(
+a&b->y-
+~a|~b->y+
+y->z-
+~y->z+
+)";
+
+	production_rule_set prs = parse_prs_string(prs_str);
+	int a = prs.netIndex("a");
+	int b = prs.netIndex("b");
+	int y = prs.netIndex("y");
+	int z = prs.netIndex("z");
+
+	S sim(&prs);
+	sim.reset();
+	for (int lane = 0; lane < S::width; lane++) {
+		sim.set(a, lane, lane&1);
+		sim.set(b, lane, (lane>>1)&1);
+	}
+	EXPECT_GE(sim.settle(), 0);
+
+	for (int lane = 0; lane < S::width; lane++) {
+		int av = lane&1;
+		int bv = (lane>>1)&1;
+		EXPECT_EQ(sim.get(y, lane), 1-(av&bv)) << "lane " << lane;
+		EXPECT_EQ(sim.get(z, lane), av&bv) << "lane " << lane;
+	}
+}
+
+TEST(ParallelSimulatorTest, NandTable) {
+	checkNandTable<parallel_simulator>();
+}
+
+TEST(ParallelSimulatorTest, WideNandTable) {
+	checkNandTable<wide_parallel_simulator>();
+}
+
+// The settled value of each lane matches the event driven simulator run on
+// the same inputs
+TEST(ParallelSimulatorTest, MatchesSimulator) {
+	string prs_str = R"(
+a&b|c->x-
+~a&~c|~b&~c->x+
+x&c->y-
+~x|~c->y+
+)";
+
+	production_rule_set prs = parse_prs_string(prs_str);
+	int in[3] = {prs.netIndex("a"), prs.netIndex("b"), prs.netIndex("c")};
+	int out[2] = {prs.netIndex("x"), prs.netIndex("y")};
+
+	parallel_simulator par(&prs);
+	par.reset();
+	for (int lane = 0; lane < 8; lane++) {
+		for (int i = 0; i < 3; i++) {
+			par.set(in[i], lane, (lane>>i)&1);
+		}
+	}
+	ASSERT_GE(par.settle(), 0);
+
+	for (int lane = 0; lane < 8; lane++) {
+		simulator sim(&prs);
+		sim.reset();
+		for (int i = 0; i < 3; i++) {
+			sim.set(in[i], (lane>>i)&1);
+		}
+		while (not sim.enabled.empty()) {
+			sim.fire();
+		}
+
+		for (int i = 0; i < 2; i++) {
+			EXPECT_EQ(par.get(out[i], lane), sim.encoding.get(out[i])) << "lane " << lane << " " << prs.netAt(out[i]);
+		}
+	}
+}
+
+// Lanes that drive an X into a gate produce interference in that lane only
+TEST(ParallelSimulatorTest, InterferenceStaysInLane) {
+	string prs_str = R"(
+a->y-
+~a->y+
+)";
+
+	production_rule_set prs = parse_prs_string(prs_str);
+	int a = prs.netIndex("a");
+	int y = prs.netIndex("y");
+
+	parallel_simulator sim(&prs);
+	sim.reset();
+	sim.set(a, parallel_simulator::word::ones(), 0);
+	sim.settle();
+	sim.set(a, 5, -1);
+	sim.settle();
+
+	for (int lane = 0; lane < parallel_simulator::width; lane++) {
+		EXPECT_EQ(sim.get(y, lane), lane == 5 ? -1 : 1) << "lane " << lane;
+	}
+}
+
+// A ring oscillator never settles
+TEST(ParallelSimulatorTest, OscillatorDoesNotSettle) {
+	string prs_str = R"(
+x->y-
+~x->y+
+y->z-
+~y->z+
+z->x-
+~z->x+
+)";
+
+	production_rule_set prs = parse_prs_string(prs_str);
+	int x = prs.netIndex("x");
+
+	parallel_simulator sim(&prs);
+	sim.reset();
+	sim.set(x, parallel_simulator::word::ones(), 0, 2);
+	EXPECT_EQ(sim.settle(100), -1);
+}
@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+#include <prs/radix_heap.h>
+#include <string>
+#include <limits>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <set>
+#include <map>
+
+struct RadixEvent {
+	uint64_t time;
+	int id;
+};
+
+struct RadixEventPriority {
+	uint64_t operator()(const RadixEvent &e) {
+		return e.time;
+	}
+};
+
+using TestHeap = radix_heap<RadixEvent, RadixEventPriority>;
+
+TEST(RadixHeap, EmptyHeap) {
+	TestHeap heap;
+	EXPECT_TRUE(heap.empty());
+	EXPECT_EQ(heap.size(), 0u);
+	EXPECT_EQ(heap.next(), TestHeap::nil);
+}
+
+TEST(RadixHeap, PopsInTimeOrder) {
+	TestHeap heap;
+	std::vector<uint64_t> times = {50u, 10u, 30u, 10u, 1u << 20, 0u, 31u, std::numeric_limits<uint64_t>::max()};
+	for (int i = 0; i < (int)times.size(); i++) {
+		heap.push(RadixEvent{times[i], i});
+	}
+	std::sort(times.begin(), times.end());
+	for (auto t = times.begin(); t != times.end(); t++) {
+		RadixEvent e = heap.pop();
+		EXPECT_EQ(e.time, *t);
+		EXPECT_EQ(heap.now, *t);
+	}
+	EXPECT_TRUE(heap.empty());
+}
+
+TEST(RadixHeap, CancelAndDecreaseKey) {
+	TestHeap heap;
+	TestHeap::handle a = heap.push(RadixEvent{100u, 0});
+	TestHeap::handle b = heap.push(RadixEvent{200u, 1});
+	TestHeap::handle c = heap.push(RadixEvent{300u, 2});
+
+	// Moving an event later is ignored, moving it earlier reorders it
+	heap.set(b, RadixEvent{400u, 1});
+	EXPECT_EQ(heap[b].value.time, 200u);
+	heap.set(c, RadixEvent{50u, 2});
+	heap.cancel(a);
+
+	EXPECT_EQ(heap.size(), 2u);
+	EXPECT_EQ(heap.pop().id, 2);
+	EXPECT_EQ(heap.pop().id, 1);
+	EXPECT_TRUE(heap.empty());
+}
+
+TEST(RadixHeap, PushBeforeNow) {
+	TestHeap heap;
+	heap.push(RadixEvent{1000u, 0});
+	heap.push(RadixEvent{2000u, 1});
+	EXPECT_EQ(heap.pop().time, 1000u);
+
+	// An event earlier than the last one popped moves now back
+	heap.push(RadixEvent{500u, 2});
+	EXPECT_EQ(heap.pop().time, 500u);
+	EXPECT_EQ(heap.pop().time, 2000u);
+}
+
+TEST(RadixHeap, RandomChurn) {
+	TestHeap heap;
+	std::mt19937 g(3);
+	std::uniform_int_distribution<uint64_t> delay(0u, 1u << 16);
+	std::multiset<uint64_t> expect;
+	std::map<int, TestHeap::handle> live;
+
+	int id = 0;
+	uint64_t now = 0u;
+	for (int i = 0; i < 20000; i++) {
+		int op = (int)(delay(g)%8u);
+		if (op < 4 or expect.empty()) {
+			uint64_t t = now + delay(g);
+			live[id] = heap.push(RadixEvent{t, id});
+			expect.insert(t);
+			id++;
+		} else if (op == 4) {
+			auto j = live.lower_bound((int)(delay(g)%(uint64_t)id));
+			if (j == live.end()) {
+				j = live.begin();
+			}
+			expect.erase(expect.find(heap[j->second].value.time));
+			heap.cancel(j->second);
+			live.erase(j);
+		} else {
+			RadixEvent e = heap.pop();
+			ASSERT_EQ(e.time, *expect.begin());
+			expect.erase(expect.begin());
+			live.erase(e.id);
+			now = e.time;
+		}
+		ASSERT_EQ(heap.size(), expect.size());
+	}
+}
+
+TEST(RadixHeap, CopyHeap) {
+	radix_heap<RadixEvent, RadixEventPriority, deque_events<RadixEvent> > heap;
+	for (int i = 0; i < 100; i++) {
+		heap.push(RadixEvent{(uint64_t)((i*37)%101), i});
+	}
+	heap.pop();
+
+	auto copy = heap;
+	while (not heap.empty()) {
+		RadixEvent e0 = heap.pop();
+		RadixEvent e1 = copy.pop();
+		EXPECT_EQ(e0.time, e1.time);
+		EXPECT_EQ(e0.id, e1.id);
+	}
+	EXPECT_TRUE(copy.empty());
+}
+
+TEST(RadixHeap, AssignHeap) {
+	radix_heap<RadixEvent, RadixEventPriority, deque_events<RadixEvent> > copy;
+	copy.push(RadixEvent{5, -1});
+
+	std::vector<uint64_t> times;
+	{
+		radix_heap<RadixEvent, RadixEventPriority, deque_events<RadixEvent> > heap;
+		for (int i = 0; i < 100; i++) {
+			times.push_back((i*37)%101);
+			heap.push(RadixEvent{times.back(), i});
+		}
+		copy = heap;
+	}
+
+	// The assigned heap must not point into the destroyed one
+	std::sort(times.begin(), times.end());
+	for (size_t i = 0; i < times.size(); i++) {
+		ASSERT_FALSE(copy.empty());
+		EXPECT_EQ(copy.pop().time, times[i]);
+	}
+	EXPECT_TRUE(copy.empty());
+}
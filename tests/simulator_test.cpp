@@ -518,3 +518,304 @@ TEST(SimulatorTest, InterferenceTest) {
 	// Both drivers want out=0, so it should be 0
 	EXPECT_EQ(sim.encoding.get(out_idx), 0);
 }
+
+TEST(SimulatorTest, RadixBackendMatchesCalendar) {
+	string prs_str = R"(
+_Reset&L.t&R.e->v3- [keep]
+~_Reset|~L.t&~R.e->v3+ [keep]
+_Reset&L.f&R.e->v2- [keep]
+~_Reset|~L.f&~R.e->v2+ [keep]
+_Reset&v0&L.e'1->v1- {v0}
+~_Reset|~v0|~L.e'1->v1+
+_Reset&v1&L.e'1->v0- {v1}
+~_Reset|~v1|~L.e'1->v0+
+R.f'1|R.t'1->R.e'1-
+~R.t'1&~R.f'1->R.e'1+
+v3->R.t-
+~v3->R.t+
+v2->R.f-
+~v2->R.f+
+R.f|R.t->L.e-
+~R.t&~R.f->L.e+
+v1->L.t'1-
+~v1->L.t'1+
+v0->L.f'1-
+~v0->L.f'1+
+)";
+
+	production_rule_set prs = parse_prs_string(prs_str);
+
+	// Both backends settle the reset phase into the same state
+	simulator sim0(&prs);
+	radix_simulator sim1(&prs);
+	sim0.reset();
+	sim1.reset();
+	while (not sim0.enabled.empty()) {
+		sim0.fire();
+	}
+	while (not sim1.enabled.empty()) {
+		sim1.fire();
+	}
+
+	for (int i = 0; i < (int)prs.nets.size(); i++) {
+		EXPECT_EQ(sim0.encoding.get(i), sim1.encoding.get(i)) << prs.netAt(i);
+	}
+}
+
+TEST(SimulatorTest, FiredTransitionCarriesGuard) {
+	string prs_str = R"(
+in->out-
+~in->out+
+)";
+
+	production_rule_set prs = parse_prs_string(prs_str);
+	simulator sim(&prs);
+	int in_idx = prs.netIndex("in");
+	int out_idx = prs.netIndex("out");
+	sim.reset();
+
+	// The guard is stored beside the queue and handed back by fire()
+	sim.set(in_idx, 1, 1);
+	ASSERT_FALSE(sim.enabled.empty());
+	enabled_transition t = sim.fire();
+	EXPECT_EQ(t.net, out_idx);
+	EXPECT_EQ(t.value, 0);
+	EXPECT_EQ(t.guard.get(in_idx), 1);
+	EXPECT_TRUE(sim.enabled.empty());
+}
+
+TEST(SimulatorTest, WorklistOrdersNodesFirst) {
+	production_rule_set prs;
+	// string literals would pick the net(bool keep) constructor
+	int a = prs.create(net(string("a")));
+	int n0 = prs.create();
+	int b = prs.create(net(string("b")));
+	int n1 = prs.create();
+
+	worklist q;
+	q.reorder(&prs);
+	q.push(b);
+	q.push(n1);
+	q.push(a);
+	q.push(b);
+	q.push(n0);
+	q.push(n1);
+
+	// nodes pop before named nets, each by index, and duplicates collapse
+	vector<int> popped;
+	while (not q.empty()) {
+		popped.push_back(q.pop());
+	}
+	EXPECT_EQ(popped, vector<int>({n0, n1, a, b}));
+
+	// a net pushed below the last pop is still found
+	q.push(b);
+	q.push(n0);
+	EXPECT_EQ(q.pop(), n0);
+	q.push(a);
+	EXPECT_EQ(q.pop(), a);
+	EXPECT_EQ(q.pop(), b);
+	EXPECT_TRUE(q.empty());
+}
+
+// Pushing a net past the end of a custom order ranks it after the others,
+// without reordering or dropping the nets already waiting
+TEST(SimulatorTest, WorklistExtendsCustomOrder) {
+	worklist q;
+	q.reorder(nullptr, vector<int>({2, 0, 1}));
+	q.push(1);
+	q.push(200);
+	q.push(2);
+	q.push(70);
+	q.push(0);
+
+	vector<int> popped;
+	while (not q.empty()) {
+		popped.push_back(q.pop());
+	}
+	EXPECT_EQ(popped, vector<int>({2, 0, 1, 70, 200}));
+	EXPECT_EQ(q.rank[2], 0);
+	EXPECT_EQ(q.order[5], 5);
+}
+
+// Restoring a snapshot returns the state, the pending events, and the delay
+// generator, so the same events fire again in the same order
+TEST(SimulatorTest, SnapshotRestore) {
+	int enable;
+	vector<int> probe;
+	production_rule_set prs = coupled_rings(64, enable, probe);
+
+	simulator sim(&prs);
+	sim.reset();
+	sim.set(enable, 0);
+	while (not sim.enabled.empty()) {
+		sim.fire();
+	}
+	sim.set(enable, 1);
+
+	simulator_state s = sim.snapshot();
+	boolean::cube encoding = sim.encoding;
+	boolean::cube global = sim.global;
+	boolean::cube strength = sim.strength;
+
+	vector<pair<uint64_t, int> > first;
+	for (int i = 0; i < 500 and not sim.enabled.empty(); i++) {
+		enabled_transition t = sim.fire();
+		first.push_back(pair<uint64_t, int>(t.fire_at, t.net));
+	}
+	ASSERT_EQ((int)first.size(), 500);
+	boolean::cube after = sim.encoding;
+
+	sim.restore(s);
+	EXPECT_EQ(sim.encoding.values, encoding.values);
+	EXPECT_EQ(sim.global.values, global.values);
+	EXPECT_EQ(sim.strength.values, strength.values);
+	for (int i = 0; i < (int)first.size(); i++) {
+		enabled_transition t = sim.fire();
+		ASSERT_EQ(t.fire_at, first[i].first) << i;
+		ASSERT_EQ(t.net, first[i].second) << i;
+	}
+	EXPECT_EQ(sim.encoding.values, after.values);
+}
+
+// Stage zero of each ring switches with no delay, so evaluate() rather than
+// commit() acknowledges its guard, including the enable and the tap from
+// the previous ring that live in other chunks. Every snapshot still restores
+// exactly the state it was taken from.
+TEST(SimulatorTest, SnapshotRestoreZeroDelay) {
+	int enable;
+	vector<int> probe;
+	production_rule_set prs = coupled_rings(64, enable, probe);
+	for (auto d = prs.devs.begin(); d != prs.devs.end(); d++) {
+		for (int i = 0; i < (int)probe.size(); i += 5) {
+			if (d->drain == probe[i]) {
+				d->attr.delay_max = 0;
+			}
+		}
+	}
+
+	simulator sim(&prs);
+	sim.reset();
+	sim.set(enable, 0);
+	while (not sim.enabled.empty()) {
+		sim.fire();
+	}
+	sim.set(enable, 1);
+
+	vector<simulator_state> states;
+	vector<boolean::cube> encodings, globals, strengths;
+	for (int i = 0; i < 300 and not sim.enabled.empty(); i++) {
+		states.push_back(sim.snapshot());
+		encodings.push_back(sim.encoding);
+		globals.push_back(sim.global);
+		strengths.push_back(sim.strength);
+		sim.fire();
+	}
+	ASSERT_EQ((int)states.size(), 300);
+
+	for (int i = (int)states.size()-1; i >= 0; i -= 7) {
+		sim.restore(states[i]);
+		ASSERT_EQ(sim.encoding.values, encodings[i].values) << i;
+		ASSERT_EQ(sim.global.values, globals[i].values) << i;
+		ASSERT_EQ(sim.strength.values, strengths[i].values) << i;
+	}
+}
+
+// A snapshot after one event shares every chunk the event did not touch,
+// and the two branches of a choice can be explored from the same snapshot
+TEST(SimulatorTest, SnapshotSharesChunks) {
+	int enable;
+	vector<int> probe;
+	production_rule_set prs = coupled_rings(64, enable, probe);
+
+	simulator sim(&prs);
+	sim.reset();
+	sim.set(enable, 0);
+	while (not sim.enabled.empty()) {
+		sim.fire();
+	}
+	sim.set(enable, 1);
+	for (int i = 0; i < 100; i++) {
+		sim.fire();
+	}
+
+	simulator_state s0 = sim.snapshot();
+	ASSERT_GT(s0.chunks.size(), 2u);
+
+	// Fire the last two pending events in either order
+	vector<int> pending;
+	for (int net = 0; net < (int)sim.nets.size(); net++) {
+		if (sim.nets[net] != simulator::queue::nil) {
+			pending.push_back(net);
+		}
+	}
+	ASSERT_GE(pending.size(), 2u);
+	int a = pending[0];
+	int b = pending.back();
+
+	sim.fire(a);
+	simulator_state s1 = sim.snapshot();
+	int shared = 0;
+	for (int k = 0; k < (int)s0.chunks.size(); k++) {
+		shared += (int)(s0.chunks[k] == s1.chunks[k]);
+	}
+	EXPECT_GE(shared, (int)s0.chunks.size()-2);
+	sim.fire(b);
+	boolean::cube ab = sim.encoding;
+
+	sim.restore(s0);
+	sim.fire(b);
+	sim.fire(a);
+	EXPECT_EQ(sim.encoding.get(a), ab.get(a));
+	EXPECT_EQ(sim.encoding.get(b), ab.get(b));
+
+	sim.restore(s1);
+	EXPECT_EQ(sim.encoding.get(a), ab.get(a));
+	EXPECT_NE(sim.nets[b], simulator::queue::nil);
+}
+
+// run_until() fires the same events as a loop over fire(), and stops at
+// each kind of limit
+TEST(SimulatorTest, RunUntil) {
+	int enable;
+	vector<int> probe;
+	production_rule_set prs = coupled_rings(4, enable, probe);
+
+	simulator a(&prs);
+	simulator b(&prs);
+	simulator *sims[2] = {&a, &b};
+	for (int i = 0; i < 2; i++) {
+		sims[i]->reset();
+		sims[i]->set(enable, 0);
+		EXPECT_EQ(sims[i]->run_until().reason, run_result::drained);
+		sims[i]->set(enable, 1);
+	}
+
+	for (int i = 0; i < 2000; i++) {
+		a.fire();
+	}
+	run_result r = b.run_until(std::numeric_limits<uint64_t>::max(), 2000);
+	EXPECT_EQ(r.reason, run_result::events);
+	EXPECT_EQ(r.fired, 2000u);
+	EXPECT_EQ(a.now, b.now);
+	EXPECT_EQ(a.encoding.values, b.encoding.values);
+
+	uint64_t until = b.now + 5000;
+	r = b.run_until(until);
+	EXPECT_EQ(r.reason, run_result::time);
+	EXPECT_LE(b.now, until);
+	EXPECT_GT(b.enabled[b.enabled.next()].value.fire_at, until);
+
+	b.watch(probe[0]);
+	r = b.run_until();
+	EXPECT_EQ(r.reason, run_result::watched);
+	EXPECT_EQ(r.net, probe[0]);
+	b.watch(probe[0], false);
+
+	int value = 1-b.encoding.get(probe[1]);
+	r = b.run_until(std::numeric_limits<uint64_t>::max(), std::numeric_limits<uint64_t>::max(), [&](const enabled_event &e) {
+		return e.net == probe[1] and e.value == value;
+	});
+	EXPECT_EQ(r.reason, run_result::stopped);
+	EXPECT_EQ(b.encoding.get(probe[1]), value);
+}
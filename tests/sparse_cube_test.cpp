@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+#include <prs/sparse_cube.h>
+#include <random>
+
+using namespace prs;
+
+TEST(SparseCube, SetAndGet) {
+	sparse_cube c;
+	EXPECT_TRUE(c.is_tautology());
+	EXPECT_EQ(c.get(3), 2);
+
+	c.set(3, 1);
+	c.set(7, 0);
+	c.set(3, 0);
+	EXPECT_EQ(c.size(), 2);
+	EXPECT_EQ(c.get(3), 0);
+	EXPECT_EQ(c.get(7), 0);
+	EXPECT_EQ(c.get(5), 2);
+}
+
+TEST(SparseCube, SpillsPastInlineStorage) {
+	sparse_cube c;
+	for (int i = 0; i < 10; i++) {
+		c.set(i*100, i%2);
+	}
+	EXPECT_EQ(c.size(), 10);
+	for (int i = 0; i < 10; i++) {
+		EXPECT_EQ(c.get(i*100), i%2);
+	}
+
+	sparse_cube d = c;
+	d.set(50, 1);
+	EXPECT_EQ(d.size(), 11);
+	EXPECT_EQ(c.size(), 10);
+	EXPECT_EQ(c.get(50), 2);
+}
+
+TEST(SparseCube, IntersectNullsAndXout) {
+	sparse_cube a(1, 1);
+	a.set(2, 0);
+	sparse_cube b(1, 0);
+	b.set(3, 1);
+
+	sparse_cube c = a & b;
+	EXPECT_EQ(c.get(1), -1);
+	EXPECT_EQ(c.get(2), 0);
+	EXPECT_EQ(c.get(3), 1);
+
+	sparse_cube x = c.xoutnulls();
+	EXPECT_EQ(x.get(1), 2);
+	EXPECT_EQ(x.size(), 2);
+}
+
+// Every sparse operation matches the dense boolean::cube operation it
+// replaces on the simulator's event path
+TEST(SparseCube, MatchesDenseCube) {
+	std::mt19937 g(7);
+	std::uniform_int_distribution<int> var(0, 40);
+	std::uniform_int_distribution<int> val(-1, 2);
+
+	for (int trial = 0; trial < 200; trial++) {
+		boolean::cube state;
+		for (int i = 0; i <= 40; i++) {
+			state.set(i, val(g));
+		}
+
+		sparse_cube s0, s1;
+		for (int i = 0; i < 4; i++) {
+			s0.set(var(g), val(g)%2);
+			s1.set(var(g), val(g)%2);
+		}
+		boolean::cube c0 = s0.cube();
+		boolean::cube c1 = s1.cube();
+
+		EXPECT_EQ((s0 & s1).cube(), c0 & c1);
+		EXPECT_EQ(s0.conflicts(state), are_mutex(state.xoutnulls(), c0));
+
+		boolean::cube dense = state;
+		dense &= c0 & c1;
+		boolean::cube sparse = state;
+		sparse &= s0;
+		sparse &= s1;
+		EXPECT_EQ(sparse, dense);
+
+		EXPECT_EQ(sparse_cube(c0).cube(), c0);
+	}
+}
+
+// Literals are visited in order, including nulls, and across word boundaries
+TEST(SparseCube, ForEachLiteral) {
+	boolean::cube c;
+	c.set(0, 1);
+	c.set(15, 0);
+	c.set(16, -1);
+	c.set(100, 1);
+
+	vector<literal> seen;
+	for_each_literal(c, [&](int var, int val) {
+		seen.push_back(literal{var, val});
+	});
+	ASSERT_EQ(seen.size(), 4u);
+	int vars[4] = {0, 15, 16, 100};
+	int vals[4] = {1, 0, -1, 1};
+	for (int i = 0; i < 4; i++) {
+		EXPECT_EQ(seen[i].var, vars[i]);
+		EXPECT_EQ(seen[i].val, vals[i]);
+	}
+
+	sparse_cube s(c);
+	EXPECT_EQ(s.size(), 4);
+	EXPECT_EQ(s.get(16), -1);
+}
@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+#include <prs/production_rule.h>
+#include <prs/simulator.h>
+#include <prs/time_warp_simulator.h>
+#include <thread>
+#include "helpers.h"
+
+using namespace prs;
+using namespace test;
+
+// Values cross block boundaries in order
+TEST(MailboxTest, KeepsOrder) {
+	mailbox<int, 4> box;
+	int value;
+	EXPECT_FALSE(box.pop(value));
+	for (int i = 0; i < 10; i++) {
+		box.push(i);
+	}
+	for (int i = 0; i < 10; i++) {
+		ASSERT_TRUE(box.pop(value));
+		EXPECT_EQ(value, i);
+	}
+	EXPECT_FALSE(box.pop(value));
+	box.push(10);
+	ASSERT_TRUE(box.pop(value));
+	EXPECT_EQ(value, 10);
+}
+
+// A consumer on another thread sees every value exactly once, in order
+TEST(MailboxTest, ProducerConsumer) {
+	const int count = 100000;
+	mailbox<int, 16> box;
+	std::thread producer([&]() {
+		for (int i = 0; i < count; i++) {
+			box.push(i);
+		}
+	});
+
+	int expect = 0;
+	int value;
+	while (expect < count) {
+		if (box.pop(value)) {
+			ASSERT_EQ(value, expect);
+			expect++;
+		}
+	}
+	producer.join();
+	EXPECT_FALSE(box.pop(value));
+}
+
+// The coupled rings are sampled as they run and match a single simulator
+// with fixed delays at every sample, whatever the workers speculated
+void checkMatchesSimulator(int interval, int epoch) {
+	int enable;
+	vector<int> probe;
+	production_rule_set prs = coupled_rings(4, enable, probe);
+
+	simulator seq(&prs);
+	seq.delay.policy = delay_model::fixed_max;
+	seq.reset();
+	time_warp_simulator par(&prs, 3);
+	par.interval = interval;
+	par.epoch = epoch;
+	par.reset();
+
+	seq.set(enable, 0);
+	par.set(enable, 0);
+	while (not seq.enabled.empty()) {
+		seq.fire();
+	}
+	EXPECT_FALSE(par.advance());
+	EXPECT_EQ(par.now, seq.now);
+
+	seq.set(enable, 1);
+	par.set(enable, 1);
+	uint64_t start = seq.now;
+	for (uint64_t t = start+5000; t < start+100000; t += 5000) {
+		while (not seq.enabled.empty() and seq.enabled[seq.enabled.next()].value.fire_at <= t) {
+			seq.fire();
+		}
+		par.advance(t);
+		for (auto n = probe.begin(); n != probe.end(); n++) {
+			ASSERT_EQ(par.get(*n), seq.encoding.get(*n)) << prs.netAt(*n) << " at " << t;
+		}
+	}
+}
+
+TEST(TimeWarpSimulatorTest, MatchesSimulator) {
+	checkMatchesSimulator(8, 256);
+}
+
+TEST(TimeWarpSimulatorTest, MatchesSimulatorEveryStep) {
+	checkMatchesSimulator(1, 1);
+}
+
+// Rolling back restores the state of the checkpoint exactly, and the
+// worker then reaches the same state again
+TEST(TimeWarpSimulatorTest, RollbackRestoresCheckpoint) {
+	int enable;
+	vector<int> probe;
+	production_rule_set prs = coupled_rings(2, enable, probe);
+
+	time_warp_simulator par(&prs, 1);
+	par.interval = 1;
+	par.reset();
+	par.set(enable, 0);
+	par.advance();
+	par.set(enable, 1);
+
+	simulator &sim = par.sims[0];
+	warp_worker &k = par.warp[0];
+	k.shadow[0] = sim.encoding.values;
+	k.shadow[1] = sim.global.values;
+	k.shadow[2] = sim.strength.values;
+	k.last = warp_time(par.now, std::numeric_limits<int>::max());
+	par.checkpoint(0, par.now);
+
+	vector<unsigned int> encoding = sim.encoding.values;
+	warp_time first = par.pending(0);
+	for (int i = 0; i < 20; i++) {
+		par.step(0, par.pending(0));
+	}
+	vector<unsigned int> later = sim.encoding.values;
+	warp_time resume = par.pending(0);
+	EXPECT_NE(later, encoding);
+
+	par.rollback(0, first.first);
+	EXPECT_EQ(sim.encoding.values, encoding);
+	EXPECT_EQ(par.pending(0), first);
+
+	for (int i = 0; i < 20; i++) {
+		par.step(0, par.pending(0));
+	}
+	EXPECT_EQ(sim.encoding.values, later);
+	EXPECT_EQ(par.pending(0), resume);
+}
+
+// Events at the same time in different workers take effect in order of net
+// however far each worker speculated
+TEST(TimeWarpSimulatorTest, SimultaneousEventsAcrossWorkers) {
+	int x, y;
+	vector<int> probe;
+	production_rule_set prs = simultaneous_regions(x, y, probe);
+
+	simulator seq(&prs);
+	seq.delay.policy = delay_model::fixed_max;
+	seq.reset();
+	time_warp_simulator par(&prs, 2);
+	par.interval = 1;
+	par.reset();
+	ASSERT_NE(par.part.owner[probe[0]], par.part.owner[probe[2]]);
+
+	for (int value = 0; value < 2; value++) {
+		seq.set(x, value);
+		seq.set(y, value);
+		par.set(x, value);
+		par.set(y, value);
+		while (not seq.enabled.empty()) {
+			seq.fire();
+		}
+		EXPECT_FALSE(par.advance());
+		EXPECT_EQ(par.now, seq.now);
+	}
+
+	for (auto n = probe.begin(); n != probe.end(); n++) {
+		EXPECT_EQ(par.get(*n), seq.encoding.get(*n)) << prs.netAt(*n);
+		EXPECT_EQ(par.strength(*n), 2-seq.strength.get(*n)) << prs.netAt(*n);
+	}
+}
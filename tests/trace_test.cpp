@@ -0,0 +1,183 @@
+#include <gtest/gtest.h>
+#include <prs/production_rule.h>
+#include <prs/simulator.h>
+#include <prs/trace.h>
+#include <fstream>
+#include <sstream>
+#include "helpers.h"
+
+using namespace prs;
+using namespace test;
+
+// The trace reads back as exactly the changes the simulator made, which for
+// a circuit without remote nets are also the changes it exports
+TEST(TraceTest, RoundTrip) {
+	int enable;
+	vector<int> probe;
+	production_rule_set prs = coupled_rings(2, enable, probe);
+	string path = ::testing::TempDir() + "trace_test.prst";
+
+	trace_writer writer;
+	ASSERT_TRUE(writer.open(&prs, path));
+
+	simulator sim(&prs);
+	sim.tracer = &writer;
+	sim.exported.assign(prs.nets.size(), true);
+	sim.reset();
+	sim.set(enable, 0);
+	while (not sim.enabled.empty()) {
+		sim.fire();
+	}
+	sim.set(enable, 1);
+	for (int i = 0; i < 5000; i++) {
+		sim.fire();
+	}
+	writer.close();
+	EXPECT_EQ(writer.written, sim.outbox.size());
+
+	trace_reader reader;
+	ASSERT_TRUE(reader.open(path));
+	ASSERT_EQ(reader.names.size(), prs.nets.size());
+	EXPECT_EQ(reader.names[enable], prs.netAt(enable));
+
+	trace_record r;
+	for (auto e = sim.outbox.begin(); e != sim.outbox.end(); e++) {
+		ASSERT_TRUE(reader.next(r));
+		EXPECT_EQ(r.time, e->fire_at);
+		EXPECT_EQ(r.net, e->net);
+		EXPECT_EQ(r.value, e->value);
+		EXPECT_EQ(r.strength, e->strength);
+		EXPECT_EQ(r.stable, e->stable);
+	}
+	EXPECT_FALSE(reader.next(r));
+}
+
+// A full ring refuses values until the consumer makes room, and keeps order
+// across the wrap
+TEST(RingTest, FillsAndWraps) {
+	ring<int> r(3);
+	EXPECT_EQ(r.capacity(), 4u);
+	int value;
+	EXPECT_FALSE(r.pop(value));
+	for (int i = 0; i < 4; i++) {
+		EXPECT_TRUE(r.push(i));
+	}
+	EXPECT_FALSE(r.push(4));
+	for (int i = 0; i < 10; i++) {
+		ASSERT_TRUE(r.pop(value));
+		EXPECT_EQ(value, i);
+		EXPECT_TRUE(r.push(i+4));
+	}
+	EXPECT_FALSE(r.push(14));
+}
+
+// With a tiny ring that drops on overflow, every change is either written
+// or counted as dropped
+TEST(TraceTest, DropsWhenFull) {
+	int enable;
+	vector<int> probe;
+	production_rule_set prs = coupled_rings(2, enable, probe);
+	string path = ::testing::TempDir() + "trace_test_drop.prst";
+
+	trace_writer writer;
+	writer.overflow = trace_writer::drop;
+	ASSERT_TRUE(writer.open(&prs, path, 2));
+
+	simulator sim(&prs);
+	sim.tracer = &writer;
+	sim.exported.assign(prs.nets.size(), true);
+	sim.reset();
+	sim.set(enable, 0);
+	while (not sim.enabled.empty()) {
+		sim.fire();
+	}
+	sim.set(enable, 1);
+	for (int i = 0; i < 5000; i++) {
+		sim.fire();
+	}
+	writer.close();
+	EXPECT_EQ(writer.written + writer.dropped, sim.outbox.size());
+
+	trace_reader reader;
+	ASSERT_TRUE(reader.open(path));
+	trace_record r;
+	uint64_t count = 0;
+	while (reader.next(r)) {
+		count++;
+	}
+	EXPECT_EQ(count, writer.written);
+}
+
+TEST(TraceTest, ExportVCD) {
+	int enable;
+	vector<int> probe;
+	production_rule_set prs = coupled_rings(1, enable, probe);
+	string path = ::testing::TempDir() + "trace_test_vcd.prst";
+	string vcd = ::testing::TempDir() + "trace_test.vcd";
+
+	trace_writer writer;
+	ASSERT_TRUE(writer.open(&prs, path));
+	simulator sim(&prs);
+	sim.tracer = &writer;
+	sim.reset();
+	sim.set(enable, 0);
+	while (not sim.enabled.empty()) {
+		sim.fire();
+	}
+	writer.close();
+
+	ASSERT_TRUE(export_vcd(path, vcd));
+	std::ifstream fin(vcd);
+	std::stringstream buf;
+	buf << fin.rdbuf();
+	string text = buf.str();
+	EXPECT_NE(text.find("$enddefinitions $end"), string::npos);
+	EXPECT_NE(text.find(" " + prs.netAt(enable) + " $end"), string::npos);
+	EXPECT_FALSE(export_vcd(vcd, vcd + ".vcd"));
+}
+
+// Restoring a snapshot moves the trace back in time, but the timestamps of
+// the VCD never decrease.
+TEST(TraceTest, ExportVCDAcrossRestore) {
+	int enable;
+	vector<int> probe;
+	production_rule_set prs = coupled_rings(2, enable, probe);
+	string path = ::testing::TempDir() + "trace_test_restore.prst";
+	string vcd = ::testing::TempDir() + "trace_test_restore.vcd";
+
+	trace_writer writer;
+	ASSERT_TRUE(writer.open(&prs, path));
+	simulator sim(&prs);
+	sim.tracer = &writer;
+	sim.reset();
+	sim.set(enable, 0);
+	while (not sim.enabled.empty()) {
+		sim.fire();
+	}
+	sim.set(enable, 1);
+	simulator_state s = sim.snapshot();
+	for (int i = 0; i < 50; i++) {
+		sim.fire();
+	}
+	sim.restore(s);
+	for (int i = 0; i < 50; i++) {
+		sim.fire();
+	}
+	writer.close();
+
+	ASSERT_TRUE(export_vcd(path, vcd));
+	std::ifstream fin(vcd);
+	string line;
+	uint64_t time = 0;
+	int restarts = 0;
+	while (std::getline(fin, line)) {
+		if (not line.empty() and line[0] == '#') {
+			uint64_t t = std::stoull(line.substr(1));
+			EXPECT_GE(t, time);
+			time = t;
+		} else if (line == "$dumpall") {
+			restarts++;
+		}
+	}
+	EXPECT_EQ(restarts, 1);
+}